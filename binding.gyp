@@ -1,7 +1,9 @@
 {
   'variables': {
     'steamworks_sdk_dir': '<!(node tools/steamworks_sdk_dir.js)',
-    'target_dir': 'lib'
+    'target_dir': 'lib',
+    # Set with `node-gyp configure -- -Dbuild_archive_benchmark=1`.
+    'build_archive_benchmark%': 0
   },
 
   'conditions': [
@@ -62,6 +64,29 @@
         }],
       ],
     }],
+    # A benchmark of greenworks::zip/unzip, see docs/archive-benchmark.md.
+    ['OS=="linux" and build_archive_benchmark==1', {
+      'targets': [
+        {
+          'target_name': 'archive_benchmark',
+          'type': 'executable',
+          'sources': [
+            'src/greenworks_archive_progress.cc',
+            'src/greenworks_unzip.cc',
+            'src/greenworks_zip.cc',
+            'src/greenworks_zip_memory.cc',
+            'tools/archive_benchmark.cc',
+          ],
+          'include_dirs': [
+            'deps',
+            'src',
+          ],
+          'dependencies': [ 'deps/zlib/zlib.gyp:minizip' ],
+          'cflags': [ '-std=c++20' ],
+          'ldflags': [ '-pthread' ],
+        },
+      ],
+    }],
   ],
 
   'targets': [
@@ -85,8 +110,14 @@
         'src/api/steam_api_utils.cc',
         'src/api/steam_api_workshop.cc',
         'src/greenworks_api.cc',
+        'src/greenworks_archive_progress.cc',
+        'src/greenworks_archive_progress.h',
         'src/greenworks_async_workers.cc',
         'src/greenworks_async_workers.h',
+        'src/greenworks_cloud_compression.cc',
+        'src/greenworks_cloud_compression.h',
+        'src/greenworks_cloud_delta.cc',
+        'src/greenworks_cloud_delta.h',
         'src/greenworks_unzip.cc',
         'src/greenworks_unzip.h',
         'src/greenworks_utils.cc',
@@ -96,6 +127,8 @@
         'src/greenworks_workshop_workers.h',
         'src/greenworks_zip.cc',
         'src/greenworks_zip.h',
+        'src/greenworks_zip_memory.cc',
+        'src/greenworks_zip_memory.h',
         'src/steam_async_worker.cc',
         'src/steam_async_worker.h',
         'src/steam_client.cc',
@@ -104,6 +137,9 @@
         'src/steam_event.h',
         'src/steam_id.cc',
         'src/steam_id.h',
+        'src/steam_lobby_data_mirror.cc',
+        'src/steam_lobby_data_mirror.h',
+        'src/steam_matchmaking_constants.h',
       ],
       'include_dirs': [
         'deps',
@@ -112,6 +112,115 @@ greenworks.updatePublishedWorkshopFile = function(options,
      error_callback);
 }
 
+// Runs a lobby search with the given filters, see docs/matchmaking.md.
+// Resolves with the lobby list snapshot of this search's own result.
+greenworks.searchLobbies = function(filters) {
+  return new Promise(function(resolve, reject) {
+    greenworks._searchLobbies(filters || {}, resolve, function(err) {
+      reject(new Error(err));
+    });
+  });
+}
+
+// Reads all |file_names| from Steam Cloud at once. |file_callback| is called
+// with each file's name and Buffer as soon as that file has been read. Returns
+// a Promise resolved with an object mapping the names to their Buffers.
+greenworks.readFiles = function(file_names, file_callback) {
+  var files = {};
+  return Promise.all(file_names.map(function(file_name) {
+    return new Promise(function(resolve, reject) {
+      greenworks.readFileFromCloud(file_name, function(buffer) {
+        files[file_name] = buffer;
+        if (file_callback)
+          file_callback(file_name, buffer);
+        resolve();
+      }, function(err) {
+        reject(new Error(file_name + ': ' + err));
+      });
+    });
+  })).then(function() { return files; });
+}
+
+// Returns a writable stream which saves |file_name| to Steam Cloud chunk by
+// chunk, so the whole file never has to be held in memory. The file is only
+// committed once the stream finishes; it's discarded if the stream is
+// destroyed before.
+greenworks.createCloudFileWriteStream = function(file_name, options) {
+  var Writable = require('stream').Writable;
+  var handle = null;
+
+  // Set while the file is being opened, so that destroying the stream waits
+  // for the handle to cancel it.
+  var pending_open = null;
+
+  function open(callback) {
+    if (handle !== null)
+      return callback(null);
+    pending_open = [];
+    function done(err) {
+      var waiting = pending_open;
+      pending_open = null;
+      callback(err);
+      waiting.forEach(function(func) { func(); });
+    }
+    greenworks._fileWriteStreamOpen(file_name, function(stream_handle) {
+      handle = stream_handle;
+      done(null);
+    }, function(err) { done(new Error(err)); });
+  }
+
+  function close(cancel, callback) {
+    var stream_handle = handle;
+    handle = null;
+    greenworks._fileWriteStreamClose(stream_handle, cancel, function() {
+      callback(null);
+    }, function(err) { callback(new Error(err)); });
+  }
+
+  // Set while a chunk is being written, so that destroying the stream waits
+  // for the write to finish before discarding the file.
+  var pending_write = null;
+
+  return new Writable({
+    highWaterMark: (options && options.highWaterMark) || 1024 * 1024,
+    write: function(chunk, encoding, callback) {
+      open(function(err) {
+        if (err)
+          return callback(err);
+        pending_write = [];
+        function done(err) {
+          var waiting = pending_write;
+          pending_write = null;
+          callback(err);
+          waiting.forEach(function(func) { func(); });
+        }
+        greenworks._fileWriteStreamWriteChunk(handle, chunk, function() {
+          done();
+        }, function(err) { done(new Error(err)); });
+      });
+    },
+    final: function(callback) {
+      open(function(err) {
+        if (err)
+          return callback(err);
+        close(false, callback);
+      });
+    },
+    destroy: function(err, callback) {
+      function cancel() {
+        if (pending_open)
+          return pending_open.push(cancel);
+        if (pending_write)
+          return pending_write.push(cancel);
+        if (handle === null)
+          return callback(err);
+        close(true, function() { callback(err); });
+      }
+      cancel();
+    }
+  });
+}
+
 // An utility function for publish related APIs.
 // It processes remains steps after saving files to Steam Cloud.
 function file_share_process(file_name, image_name, next_process_func,
@@ -2,7 +2,11 @@
 // Use of this source code is governed by the MIT license that can be
 // found in the LICENSE file.
 
+#include <atomic>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "nan.h"
 #include "v8.h"
@@ -14,10 +18,99 @@ namespace greenworks {
 namespace api {
 namespace {
 
+// Reads an optional unsigned integer option. Returns false if it is set to
+// anything else.
+bool GetUint32Option(v8::Local<v8::Object> options, const char* name,
+                     int* value) {
+  v8::Local<v8::Value> option =
+      Nan::Get(options, Nan::New(name).ToLocalChecked()).ToLocalChecked();
+  if (option->IsUndefined())
+    return true;
+  if (!option->IsUint32())
+    return false;
+  *value = Nan::To<int>(option).FromJust();
+  return true;
+}
+
+// Reads an optional string option. Returns false if it is set to anything
+// else.
+bool GetStringOption(v8::Local<v8::Object> options, const char* name,
+                     std::string* value) {
+  v8::Local<v8::Value> option =
+      Nan::Get(options, Nan::New(name).ToLocalChecked()).ToLocalChecked();
+  if (option->IsUndefined())
+    return true;
+  if (!option->IsString())
+    return false;
+  *value = *(Nan::Utf8String(option));
+  return true;
+}
+
+// Reads an optional function option into a new |callback|. Returns false if
+// it is set to anything else.
+bool GetCallbackOption(v8::Local<v8::Object> options, const char* name,
+                       Nan::Callback** callback) {
+  v8::Local<v8::Value> option =
+      Nan::Get(options, Nan::New(name).ToLocalChecked()).ToLocalChecked();
+  if (option->IsUndefined())
+    return true;
+  if (!option->IsFunction())
+    return false;
+  *callback = new Nan::Callback(option.As<v8::Function>());
+  return true;
+}
+
+// The cancel flags of the running createArchive and extractArchive jobs, by
+// the handle returned for them.
+std::map<uint32_t, std::weak_ptr<std::atomic<bool>>> archive_jobs;
+uint32_t next_archive_job = 1;
+
+// Returns the handle of a new job cancelled through |cancel|.
+uint32_t AddArchiveJob(const std::shared_ptr<std::atomic<bool>>& cancel) {
+  // The workers of finished jobs are gone, and their flags with them.
+  for (auto it = archive_jobs.begin(); it != archive_jobs.end();) {
+    if (it->second.expired())
+      it = archive_jobs.erase(it);
+    else
+      ++it;
+  }
+  archive_jobs[next_archive_job] = cancel;
+  return next_archive_job++;
+}
+
+// Reads the options shared by createArchive and createArchiveToBuffer.
+bool GetZipOptions(v8::Local<v8::Object> options,
+                   greenworks::ZipOptions* zip_options) {
+  v8::Local<v8::Value> max_bytes =
+      Nan::Get(options, Nan::New("maxBytesInFlight").ToLocalChecked())
+          .ToLocalChecked();
+  v8::Local<v8::Value> store_incompressible =
+      Nan::Get(options, Nan::New("storeIncompressible").ToLocalChecked())
+          .ToLocalChecked();
+  if (!GetUint32Option(options, "threads", &zip_options->num_threads))
+    return false;
+  if (!max_bytes->IsUndefined()) {
+    if (!max_bytes->IsNumber() || Nan::To<double>(max_bytes).FromJust() < 0)
+      return false;
+    zip_options->max_bytes_in_flight =
+        static_cast<size_t>(Nan::To<double>(max_bytes).FromJust());
+  }
+  if (!store_incompressible->IsUndefined())
+    zip_options->store_incompressible =
+        Nan::To<bool>(store_incompressible).FromJust();
+  zip_options->adaptive_levels = Nan::To<bool>(
+      Nan::Get(options, Nan::New("adaptiveLevels").ToLocalChecked())
+          .ToLocalChecked()).FromJust();
+  zip_options->update = Nan::To<bool>(
+      Nan::Get(options, Nan::New("update").ToLocalChecked())
+          .ToLocalChecked()).FromJust();
+  return true;
+}
+
 NAN_METHOD(CreateArchive) {
   Nan::HandleScope scope;
   if (info.Length() < 5 || !info[0]->IsString() || !info[1]->IsString() ||
-      !info[2]->IsString() || !info[3]->IsInt32() || !info[4]->IsFunction()) {
+      !info[2]->IsString() || !info[3]->IsInt32()) {
     THROW_BAD_ARGS("bad arguments");
   }
   std::string zip_file_path = *(Nan::Utf8String(info[0]));
@@ -25,38 +118,313 @@ NAN_METHOD(CreateArchive) {
   std::string password = *(Nan::Utf8String(info[2]));
   int compress_level = Nan::To<int>(info[3]).FromJust();
 
+  // The options are optional.
+  int callback_index = 4;
+  greenworks::ZipOptions options;
+  options.compression_level = compress_level;
+  Nan::Callback* progress_callback = nullptr;
+  if (info[4]->IsObject() && !info[4]->IsFunction()) {
+    v8::Local<v8::Object> options_object = info[4].As<v8::Object>();
+    if (!GetZipOptions(options_object, &options) ||
+        !GetCallbackOption(options_object, "progress", &progress_callback)) {
+      delete progress_callback;
+      THROW_BAD_ARGS("bad arguments");
+    }
+    callback_index = 5;
+  }
+  if (info.Length() <= callback_index || !info[callback_index]->IsFunction()) {
+    delete progress_callback;
+    THROW_BAD_ARGS("bad arguments");
+  }
+
   Nan::Callback* success_callback =
-      new Nan::Callback(info[4].As<v8::Function>());
+      new Nan::Callback(info[callback_index].As<v8::Function>());
   Nan::Callback* error_callback = nullptr;
 
-  if (info.Length() > 5 && info[5]->IsFunction())
-    error_callback = new Nan::Callback(info[5].As<v8::Function>());
+  if (info.Length() > callback_index + 1 &&
+      info[callback_index + 1]->IsFunction()) {
+    error_callback =
+        new Nan::Callback(info[callback_index + 1].As<v8::Function>());
+  }
 
+  auto cancel = std::make_shared<std::atomic<bool>>(false);
   Nan::AsyncQueueWorker(new greenworks::CreateArchiveWorker(
-      success_callback, error_callback, zip_file_path, source_dir, password,
-      compress_level));
-  info.GetReturnValue().Set(Nan::Undefined());
+      success_callback, error_callback, progress_callback, zip_file_path,
+      source_dir, password, options, cancel));
+  info.GetReturnValue().Set(Nan::New(AddArchiveJob(cancel)));
 }
 
 NAN_METHOD(ExtractArchive) {
   Nan::HandleScope scope;
   if (info.Length() < 4 || !info[0]->IsString() || !info[1]->IsString() ||
-      !info[2]->IsString() || !info[3]->IsFunction()) {
+      !info[2]->IsString()) {
     THROW_BAD_ARGS("bad arguments");
   }
   std::string zip_file_path = *(Nan::Utf8String(info[0]));
   std::string extract_dir = *(Nan::Utf8String(info[1]));
   std::string password = *(Nan::Utf8String(info[2]));
 
+  // The options are optional.
+  int callback_index = 3;
+  int num_threads = 0;
+  Nan::Callback* progress_callback = nullptr;
+  if (info[3]->IsObject() && !info[3]->IsFunction()) {
+    v8::Local<v8::Object> options = info[3].As<v8::Object>();
+    if (!GetUint32Option(options, "threads", &num_threads) ||
+        !GetCallbackOption(options, "progress", &progress_callback)) {
+      delete progress_callback;
+      THROW_BAD_ARGS("bad arguments");
+    }
+    callback_index = 4;
+  }
+  if (info.Length() <= callback_index || !info[callback_index]->IsFunction()) {
+    delete progress_callback;
+    THROW_BAD_ARGS("bad arguments");
+  }
+
   Nan::Callback* success_callback =
-      new Nan::Callback(info[3].As<v8::Function>());
+      new Nan::Callback(info[callback_index].As<v8::Function>());
   Nan::Callback* error_callback = nullptr;
 
-  if (info.Length() > 4 && info[4]->IsFunction())
-    error_callback = new Nan::Callback(info[4].As<v8::Function>());
+  if (info.Length() > callback_index + 1 &&
+      info[callback_index + 1]->IsFunction()) {
+    error_callback =
+        new Nan::Callback(info[callback_index + 1].As<v8::Function>());
+  }
 
+  auto cancel = std::make_shared<std::atomic<bool>>(false);
   Nan::AsyncQueueWorker(new greenworks::ExtractArchiveWorker(
-      success_callback, error_callback, zip_file_path, extract_dir, password));
+      success_callback, error_callback, progress_callback, zip_file_path,
+      extract_dir, password, num_threads, cancel));
+  info.GetReturnValue().Set(Nan::New(AddArchiveJob(cancel)));
+}
+
+NAN_METHOD(CancelArchive) {
+  Nan::HandleScope scope;
+  if (info.Length() < 1 || !info[0]->IsUint32()) {
+    THROW_BAD_ARGS("bad arguments");
+  }
+  auto job = archive_jobs.find(Nan::To<uint32_t>(info[0]).FromJust());
+  std::shared_ptr<std::atomic<bool>> cancel;
+  if (job != archive_jobs.end())
+    cancel = job->second.lock();
+  if (cancel)
+    *cancel = true;
+  info.GetReturnValue().Set(Nan::New(cancel != nullptr));
+}
+
+NAN_METHOD(CreateArchiveToBuffer) {
+  Nan::HandleScope scope;
+  if (info.Length() < 2 || !info[0]->IsObject() || info[0]->IsFunction()) {
+    THROW_BAD_ARGS("bad arguments");
+  }
+  v8::Local<v8::Object> entries_object = info[0].As<v8::Object>();
+
+  // The options are optional.
+  int callback_index = 1;
+  std::string password;
+  greenworks::ZipOptions zip_options;
+  if (info[1]->IsObject() && !info[1]->IsFunction()) {
+    v8::Local<v8::Object> options = info[1].As<v8::Object>();
+    if (!GetStringOption(options, "password", &password) ||
+        !GetUint32Option(options, "level", &zip_options.compression_level) ||
+        zip_options.compression_level > 9 ||
+        !GetZipOptions(options, &zip_options)) {
+      THROW_BAD_ARGS("bad arguments");
+    }
+    callback_index = 2;
+  }
+  if (info.Length() <= callback_index || !info[callback_index]->IsFunction())
+    THROW_BAD_ARGS("bad arguments");
+
+  // Strings are copied into Buffers, and all Buffers are kept alive by the
+  // worker, so the entries are read in place on the worker threads.
+  v8::Local<v8::Array> names =
+      Nan::GetOwnPropertyNames(entries_object).ToLocalChecked();
+  v8::Local<v8::Array> buffers = Nan::New<v8::Array>(names->Length());
+  std::vector<greenworks::ZipMemoryEntry> entries;
+  for (uint32_t i = 0; i < names->Length(); ++i) {
+    v8::Local<v8::Value> name = Nan::Get(names, i).ToLocalChecked();
+    v8::Local<v8::Value> value =
+        Nan::Get(entries_object, name).ToLocalChecked();
+    v8::Local<v8::Object> buffer;
+    if (node::Buffer::HasInstance(value)) {
+      buffer = value.As<v8::Object>();
+    } else if (value->IsString()) {
+      Nan::Utf8String content(value);
+      buffer = Nan::CopyBuffer(*content, content.length()).ToLocalChecked();
+    } else {
+      THROW_BAD_ARGS("bad arguments");
+    }
+    Nan::Set(buffers, i, buffer);
+    greenworks::ZipMemoryEntry entry;
+    entry.name = *(Nan::Utf8String(name));
+    entry.data = node::Buffer::Data(buffer);
+    entry.size = node::Buffer::Length(buffer);
+    entries.push_back(entry);
+  }
+
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[callback_index].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > callback_index + 1 &&
+      info[callback_index + 1]->IsFunction()) {
+    error_callback =
+        new Nan::Callback(info[callback_index + 1].As<v8::Function>());
+  }
+
+  auto* worker = new greenworks::CreateArchiveToBufferWorker(
+      success_callback, error_callback, std::move(entries), password,
+      zip_options);
+  worker->SaveToPersistent("buffers", buffers);
+  Nan::AsyncQueueWorker(worker);
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(ExtractArchiveFromBuffer) {
+  Nan::HandleScope scope;
+  if (info.Length() < 2 || !node::Buffer::HasInstance(info[0])) {
+    THROW_BAD_ARGS("bad arguments");
+  }
+  v8::Local<v8::Object> buffer = info[0].As<v8::Object>();
+
+  // The options are optional.
+  int callback_index = 1;
+  std::string password;
+  int num_threads = 0;
+  if (info[1]->IsObject() && !info[1]->IsFunction()) {
+    v8::Local<v8::Object> options = info[1].As<v8::Object>();
+    if (!GetStringOption(options, "password", &password) ||
+        !GetUint32Option(options, "threads", &num_threads)) {
+      THROW_BAD_ARGS("bad arguments");
+    }
+    callback_index = 2;
+  }
+  if (info.Length() <= callback_index || !info[callback_index]->IsFunction())
+    THROW_BAD_ARGS("bad arguments");
+
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[callback_index].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > callback_index + 1 &&
+      info[callback_index + 1]->IsFunction()) {
+    error_callback =
+        new Nan::Callback(info[callback_index + 1].As<v8::Function>());
+  }
+
+  auto* worker = new greenworks::ExtractArchiveFromBufferWorker(
+      success_callback, error_callback, node::Buffer::Data(buffer),
+      node::Buffer::Length(buffer), password, num_threads);
+  worker->SaveToPersistent("archive", buffer);
+  Nan::AsyncQueueWorker(worker);
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(ListArchive) {
+  Nan::HandleScope scope;
+  if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsFunction()) {
+    THROW_BAD_ARGS("bad arguments");
+  }
+  std::string zip_file_path = *(Nan::Utf8String(info[0]));
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[1].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > 2 && info[2]->IsFunction())
+    error_callback = new Nan::Callback(info[2].As<v8::Function>());
+
+  Nan::AsyncQueueWorker(new greenworks::ListArchiveWorker(
+      success_callback, error_callback, zip_file_path));
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(ExtractEntries) {
+  Nan::HandleScope scope;
+  if (info.Length() < 4 || !info[0]->IsString() ||
+      !(info[1]->IsArray() || info[1]->IsString()) || !info[2]->IsString()) {
+    THROW_BAD_ARGS("bad arguments");
+  }
+  std::string zip_file_path = *(Nan::Utf8String(info[0]));
+  // An array holds entry names, a string is a glob.
+  std::vector<std::string> names;
+  bool glob = info[1]->IsString();
+  if (glob) {
+    names.push_back(*(Nan::Utf8String(info[1])));
+  } else {
+    v8::Local<v8::Array> names_array = info[1].As<v8::Array>();
+    for (uint32_t i = 0; i < names_array->Length(); ++i) {
+      v8::Local<v8::Value> name = Nan::Get(names_array, i).ToLocalChecked();
+      if (!name->IsString())
+        THROW_BAD_ARGS("bad arguments");
+      names.push_back(*(Nan::Utf8String(name)));
+    }
+  }
+  std::string extract_dir = *(Nan::Utf8String(info[2]));
+
+  // The options are optional.
+  int callback_index = 3;
+  std::string password;
+  int num_threads = 0;
+  if (info[3]->IsObject() && !info[3]->IsFunction()) {
+    v8::Local<v8::Object> options = info[3].As<v8::Object>();
+    if (!GetStringOption(options, "password", &password) ||
+        !GetUint32Option(options, "threads", &num_threads)) {
+      THROW_BAD_ARGS("bad arguments");
+    }
+    callback_index = 4;
+  }
+  if (info.Length() <= callback_index || !info[callback_index]->IsFunction())
+    THROW_BAD_ARGS("bad arguments");
+
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[callback_index].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > callback_index + 1 &&
+      info[callback_index + 1]->IsFunction()) {
+    error_callback =
+        new Nan::Callback(info[callback_index + 1].As<v8::Function>());
+  }
+
+  Nan::AsyncQueueWorker(new greenworks::ExtractEntriesWorker(
+      success_callback, error_callback, zip_file_path, names, glob,
+      extract_dir, password, num_threads));
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(ReadEntry) {
+  Nan::HandleScope scope;
+  if (info.Length() < 3 || !info[0]->IsString() || !info[1]->IsString()) {
+    THROW_BAD_ARGS("bad arguments");
+  }
+  std::string zip_file_path = *(Nan::Utf8String(info[0]));
+  std::string name = *(Nan::Utf8String(info[1]));
+
+  // The options are optional.
+  int callback_index = 2;
+  std::string password;
+  if (info[2]->IsObject() && !info[2]->IsFunction()) {
+    if (!GetStringOption(info[2].As<v8::Object>(), "password", &password))
+      THROW_BAD_ARGS("bad arguments");
+    callback_index = 3;
+  }
+  if (info.Length() <= callback_index || !info[callback_index]->IsFunction())
+    THROW_BAD_ARGS("bad arguments");
+
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[callback_index].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > callback_index + 1 &&
+      info[callback_index + 1]->IsFunction()) {
+    error_callback =
+        new Nan::Callback(info[callback_index + 1].As<v8::Function>());
+  }
+
+  Nan::AsyncQueueWorker(new greenworks::ReadEntryWorker(
+      success_callback, error_callback, zip_file_path, name, password));
   info.GetReturnValue().Set(Nan::Undefined());
 }
 
@@ -65,6 +433,12 @@ void RegisterAPIs(v8::Local<v8::Object> exports) {
   v8::Local<v8::FunctionTemplate> tpl = Nan::New<v8::FunctionTemplate>();
   Nan::SetMethod(tpl, "createArchive", CreateArchive);
   Nan::SetMethod(tpl, "extractArchive", ExtractArchive);
+  Nan::SetMethod(tpl, "cancelArchive", CancelArchive);
+  Nan::SetMethod(tpl, "createArchiveToBuffer", CreateArchiveToBuffer);
+  Nan::SetMethod(tpl, "extractArchiveFromBuffer", ExtractArchiveFromBuffer);
+  Nan::SetMethod(tpl, "listArchive", ListArchive);
+  Nan::SetMethod(tpl, "extractEntries", ExtractEntries);
+  Nan::SetMethod(tpl, "readEntry", ReadEntry);
   Nan::Persistent<v8::Function> constructor;
   constructor.Reset(Nan::GetFunction(tpl).ToLocalChecked());
   Nan::Set(exports, Nan::New("Utils").ToLocalChecked(),
@@ -2,12 +2,17 @@
 // Use of this source code is governed by the MIT license that can be
 // found in the LICENSE file.
 
+#include <cstdlib>
+#include <cstring>
 #include <string>
 
 #include "nan.h"
 #include "v8.h"
 
 #include "greenworks_async_workers.h"
+#include "greenworks_cloud_compression.h"
+#include "greenworks_cloud_delta.h"
+#include "greenworks_utils.h"
 #include "steam/steam_api.h"
 #include "steam_api_registry.h"
 
@@ -15,27 +20,252 @@ namespace greenworks {
 namespace api {
 namespace {
 
+// The default number of bytes of file content saveFilesToCloud keeps in
+// memory at once.
+const size_t kDefaultMaxBytesInFlight = 32 * 1024 * 1024;
+
+// saveDeltaFileToCloud writes a new checkpoint once the delta is larger than
+// this share of the file.
+const double kDefaultMaxDeltaRatio = 0.5;
+
+// Matches |name| against a glob |pattern|, where '*' matches any run of
+// characters and '?' any single character.
+bool MatchGlob(const char* name, const char* pattern) {
+  const char* star = nullptr;
+  const char* star_name = nullptr;
+  while (*name) {
+    if (*pattern == '?' || *pattern == *name) {
+      ++name;
+      ++pattern;
+    } else if (*pattern == '*') {
+      star = pattern++;
+      star_name = name;
+    } else if (star) {
+      pattern = star + 1;
+      name = ++star_name;
+    } else {
+      return false;
+    }
+  }
+  while (*pattern == '*')
+    ++pattern;
+  return *pattern == '\0';
+}
+
+// Reads the optional |compress| option of the save APIs.
+bool GetCompressOption(v8::Local<v8::Object> options, bool* compress) {
+  v8::Local<v8::Value> value =
+      Nan::Get(options, Nan::New("compress").ToLocalChecked())
+          .ToLocalChecked();
+  if (value->IsUndefined())
+    return true;
+  if (!value->IsBoolean())
+    return false;
+  *compress = Nan::To<bool>(value).FromJust();
+  return true;
+}
+
+// A cloud file read using FileReadAsync. The read is started on the main
+// thread and its call result is delivered by the Steam callback pump, so no
+// thread waits on it and any number of reads can be in flight at once. The
+// object deletes itself once the callbacks have been called.
+class CloudFileRead {
+ public:
+  // Reads |length| bytes of |file_name| from |offset|, or up to the end of the
+  // file if |length| is -1. The result is passed to |success_callback| as a
+  // Buffer, or as a string cut at the first NUL byte if |as_text|. Whole
+  // compressed files are decompressed on a worker thread first.
+  static void Start(const std::string& file_name, uint32 offset, int64 length,
+                    bool as_text, Nan::Callback* success_callback,
+                    Nan::Callback* error_callback) {
+    CloudFileRead* read = new CloudFileRead(as_text, success_callback,
+                                            error_callback);
+    read->Read(file_name, offset, length);
+  }
+
+ private:
+  CloudFileRead(bool as_text, Nan::Callback* success_callback,
+                Nan::Callback* error_callback)
+      : as_text_(as_text),
+        success_callback_(success_callback),
+        error_callback_(error_callback),
+        content_(nullptr),
+        content_size_(0),
+        is_whole_file_(false) {}
+
+  ~CloudFileRead() {
+    delete success_callback_;
+    delete error_callback_;
+    free(content_);
+  }
+
+  void Read(const std::string& file_name, uint32 offset, int64 length) {
+    ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+    if (!steam_remote_storage->FileExists(file_name.c_str())) {
+      CompleteLater("File doesn't exist.");
+      return;
+    }
+    uint32 file_size = steam_remote_storage->GetFileSize(file_name.c_str());
+    if (offset > file_size) {
+      CompleteLater("Offset is out of the file's range.");
+      return;
+    }
+    content_size_ = file_size - offset;
+    if (length >= 0 && length < content_size_)
+      content_size_ = static_cast<uint32>(length);
+    is_whole_file_ = content_size_ == file_size;
+    if (content_size_ == 0) {
+      CompleteLater(nullptr);
+      return;
+    }
+
+    // Allocated with malloc, since the Buffer created from it frees it.
+    content_ = static_cast<char*>(malloc(content_size_));
+    SteamAPICall_t steam_api_call = content_
+        ? steam_remote_storage->FileReadAsync(file_name.c_str(), offset,
+                                              content_size_)
+        : k_uAPICallInvalid;
+    if (steam_api_call == k_uAPICallInvalid) {
+      CompleteLater("Error on reading file.");
+      return;
+    }
+    call_result_.Set(steam_api_call, this,
+                     &CloudFileRead::OnFileReadAsyncCompleted);
+  }
+
+  void OnFileReadAsyncCompleted(RemoteStorageFileReadAsyncComplete_t* result,
+                                bool io_failure) {
+    if (io_failure) {
+      Complete("Error on reading file: Steam API IO Failure");
+    } else if (result->m_eResult != k_EResultOK ||
+               result->m_cubRead != content_size_ ||
+               !SteamRemoteStorage()->FileReadAsyncComplete(
+                   result->m_hFileReadAsync, content_, content_size_)) {
+      Complete("Error on reading file.");
+    } else {
+      Complete(nullptr);
+    }
+  }
+
+  // Completes the read on the next loop iteration, so that callbacks are
+  // never called before the JS function starting the read returns.
+  void CompleteLater(const char* error_message) {
+    if (error_message)
+      error_message_ = error_message;
+    uv_timer_t* timer = new uv_timer_t();
+    timer->data = this;
+    uv_timer_init(uv_default_loop(), timer);
+    uv_timer_start(timer, &CloudFileRead::OnTimeout, 0, 0);
+  }
+
+#if NAUV_UVVERSION < 0x000b17
+  static void OnTimeout(uv_timer_t* handle, int status_code) {
+#else
+  static void OnTimeout(uv_timer_t* handle) {
+#endif
+    auto* read = static_cast<CloudFileRead*>(handle->data);
+    uv_close(reinterpret_cast<uv_handle_t*>(handle), &OnTimerClosed);
+    read->Complete(read->error_message_.empty()
+                       ? nullptr
+                       : read->error_message_.c_str());
+  }
+
+  static void OnTimerClosed(uv_handle_t* handle) {
+    delete reinterpret_cast<uv_timer_t*>(handle);
+  }
+
+  void Complete(const char* error_message) {
+    Nan::HandleScope scope;
+    if (error_message) {
+      if (error_callback_) {
+        v8::Local<v8::Value> argv[] = {
+            Nan::New(error_message).ToLocalChecked()};
+        Nan::AsyncResource resource("greenworks:CloudFileRead.Complete");
+        error_callback_->Call(1, argv, &resource);
+      }
+      delete this;
+      return;
+    }
+
+    if (is_whole_file_ && content_ &&
+        IsCompressedCloudFile(content_, content_size_)) {
+      // The worker takes over |content_| and the callbacks.
+      Nan::AsyncQueueWorker(new greenworks::FileDecompressWorker(
+          success_callback_, error_callback_, content_, content_size_,
+          as_text_));
+      content_ = nullptr;
+      success_callback_ = nullptr;
+      error_callback_ = nullptr;
+      delete this;
+      return;
+    }
+
+    v8::Local<v8::Value> argv[1];
+    if (as_text_) {
+      int text_length =
+          content_ ? static_cast<int>(strnlen(content_, content_size_)) : 0;
+      argv[0] = Nan::New(content_ ? content_ : "", text_length)
+                    .ToLocalChecked();
+    } else if (content_) {
+      // The Buffer takes over |content_|.
+      argv[0] = Nan::NewBuffer(content_, content_size_).ToLocalChecked();
+      content_ = nullptr;
+    } else {
+      argv[0] = Nan::NewBuffer(0).ToLocalChecked();
+    }
+    Nan::AsyncResource resource("greenworks:CloudFileRead.Complete");
+    success_callback_->Call(1, argv, &resource);
+    delete this;
+  }
+
+  bool as_text_;
+  Nan::Callback* success_callback_;
+  Nan::Callback* error_callback_;
+  char* content_;
+  uint32 content_size_;
+  bool is_whole_file_;
+  std::string error_message_;
+  CCallResult<CloudFileRead, RemoteStorageFileReadAsyncComplete_t>
+      call_result_;
+};
+
 NAN_METHOD(SaveTextToFile) {
   Nan::HandleScope scope;
 
-  if (info.Length() < 3 || !info[0]->IsString() || !info[1]->IsString() ||
-      !info[2]->IsFunction()) {
+  if (info.Length() < 3 || !info[0]->IsString() || !info[1]->IsString()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+
+  // The options are optional.
+  int callback_index = 2;
+  bool compress = false;
+  if (info[2]->IsObject() && !info[2]->IsFunction()) {
+    if (!GetCompressOption(info[2].As<v8::Object>(), &compress))
+      THROW_BAD_ARGS("Bad arguments");
+    callback_index = 3;
+  }
+
+  if (info.Length() <= callback_index || !info[callback_index]->IsFunction()) {
     THROW_BAD_ARGS("Bad arguments");
   }
 
   std::string file_name(*(Nan::Utf8String(info[0])));
   std::string content(*(Nan::Utf8String(info[1])));
   Nan::Callback* success_callback =
-      new Nan::Callback(info[2].As<v8::Function>());
+      new Nan::Callback(info[callback_index].As<v8::Function>());
   Nan::Callback* error_callback = nullptr;
 
-  if (info.Length() > 3 && info[3]->IsFunction())
-    error_callback = new Nan::Callback(info[3].As<v8::Function>());
+  if (info.Length() > callback_index + 1 &&
+      info[callback_index + 1]->IsFunction()) {
+    error_callback =
+        new Nan::Callback(info[callback_index + 1].As<v8::Function>());
+  }
 
   Nan::AsyncQueueWorker(new greenworks::FileContentSaveWorker(success_callback,
                                                               error_callback,
                                                               file_name,
-                                                              content));
+                                                              content,
+                                                              compress));
   info.GetReturnValue().Set(Nan::Undefined());
 }
 
@@ -62,7 +292,7 @@ NAN_METHOD(DeleteFile) {
 
 NAN_METHOD(SaveFilesToCloud) {
   Nan::HandleScope scope;
-  if (info.Length() < 2 || !info[0]->IsArray() || !info[1]->IsFunction()) {
+  if (info.Length() < 2 || !info[0]->IsArray()) {
     THROW_BAD_ARGS("Bad arguments");
   }
   v8::Local<v8::Array> files = info[0].As<v8::Array>();
@@ -76,15 +306,151 @@ NAN_METHOD(SaveFilesToCloud) {
       files_path.push_back(*string_array);
   }
 
+  // The options are optional.
+  int callback_index = 1;
+  size_t max_bytes_in_flight = kDefaultMaxBytesInFlight;
+  bool compress = false;
+  Nan::Callback* progress_callback = nullptr;
+  if (info[1]->IsObject() && !info[1]->IsFunction()) {
+    v8::Local<v8::Object> options = info[1].As<v8::Object>();
+    v8::Local<v8::Value> max_bytes_value =
+        Nan::Get(options, Nan::New("maxBytesInFlight").ToLocalChecked())
+            .ToLocalChecked();
+    v8::Local<v8::Value> progress_value =
+        Nan::Get(options, Nan::New("progress").ToLocalChecked())
+            .ToLocalChecked();
+    if ((!max_bytes_value->IsUndefined() && !max_bytes_value->IsUint32()) ||
+        (!progress_value->IsUndefined() && !progress_value->IsFunction()) ||
+        !GetCompressOption(options, &compress)) {
+      THROW_BAD_ARGS("Bad arguments");
+    }
+    if (!max_bytes_value->IsUndefined())
+      max_bytes_in_flight = Nan::To<uint32>(max_bytes_value).FromJust();
+    if (progress_value->IsFunction())
+      progress_callback = new Nan::Callback(progress_value.As<v8::Function>());
+    callback_index = 2;
+  }
+
+  if (info.Length() <= callback_index || !info[callback_index]->IsFunction()) {
+    delete progress_callback;
+    THROW_BAD_ARGS("Bad arguments");
+  }
+
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[callback_index].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > callback_index + 1 &&
+      info[callback_index + 1]->IsFunction()) {
+    error_callback =
+        new Nan::Callback(info[callback_index + 1].As<v8::Function>());
+  }
+  Nan::AsyncQueueWorker(new greenworks::FilesSaveWorker(
+      success_callback, error_callback, progress_callback, files_path,
+      max_bytes_in_flight, compress));
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(SyncFilesToCloud) {
+  Nan::HandleScope scope;
+  if (info.Length() < 3 || !info[0]->IsArray() || !info[1]->IsString() ||
+      !info[2]->IsFunction()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  v8::Local<v8::Array> files = info[0].As<v8::Array>();
+  std::vector<std::string> files_path;
+  for (uint32_t i = 0; i < files->Length(); ++i) {
+    if (!Nan::Get(files, i).ToLocalChecked()->IsString())
+      THROW_BAD_ARGS("Bad arguments");
+    Nan::Utf8String string_array(Nan::Get(files, i).ToLocalChecked());
+    // Ignore empty path.
+    if (string_array.length() > 0)
+      files_path.push_back(*string_array);
+  }
+  std::string manifest_path(*(Nan::Utf8String(info[1])));
+
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[2].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > 3 && info[3]->IsFunction())
+    error_callback = new Nan::Callback(info[3].As<v8::Function>());
+  Nan::AsyncQueueWorker(new greenworks::FilesSyncWorker(
+      success_callback, error_callback, files_path, manifest_path));
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(SaveDeltaFileToCloud) {
+  Nan::HandleScope scope;
+  if (info.Length() < 2 || !info[0]->IsString()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+
+  // The options are optional.
+  int callback_index = 1;
+  uint32 block_size = greenworks::kDefaultDeltaBlockSize;
+  double max_delta_ratio = kDefaultMaxDeltaRatio;
+  if (info[1]->IsObject() && !info[1]->IsFunction()) {
+    v8::Local<v8::Object> options = info[1].As<v8::Object>();
+    v8::Local<v8::Value> block_size_value =
+        Nan::Get(options, Nan::New("blockSize").ToLocalChecked())
+            .ToLocalChecked();
+    v8::Local<v8::Value> ratio_value =
+        Nan::Get(options, Nan::New("maxDeltaRatio").ToLocalChecked())
+            .ToLocalChecked();
+    if (!block_size_value->IsUndefined()) {
+      if (!block_size_value->IsUint32() ||
+          Nan::To<uint32>(block_size_value).FromJust() == 0) {
+        THROW_BAD_ARGS("Bad arguments");
+      }
+      block_size = Nan::To<uint32>(block_size_value).FromJust();
+    }
+    if (!ratio_value->IsUndefined()) {
+      if (!ratio_value->IsNumber())
+        THROW_BAD_ARGS("Bad arguments");
+      max_delta_ratio = Nan::To<double>(ratio_value).FromJust();
+    }
+    callback_index = 2;
+  }
+
+  if (info.Length() <= callback_index || !info[callback_index]->IsFunction()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+
+  std::string file_path(*(Nan::Utf8String(info[0])));
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[callback_index].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > callback_index + 1 &&
+      info[callback_index + 1]->IsFunction()) {
+    error_callback =
+        new Nan::Callback(info[callback_index + 1].As<v8::Function>());
+  }
+
+  Nan::AsyncQueueWorker(new greenworks::DeltaFileSaveWorker(
+      success_callback, error_callback, file_path, block_size,
+      max_delta_ratio));
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(ReadDeltaFileFromCloud) {
+  Nan::HandleScope scope;
+
+  if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsFunction()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+
+  std::string file_name(*(Nan::Utf8String(info[0])));
   Nan::Callback* success_callback =
       new Nan::Callback(info[1].As<v8::Function>());
   Nan::Callback* error_callback = nullptr;
 
   if (info.Length() > 2 && info[2]->IsFunction())
     error_callback = new Nan::Callback(info[2].As<v8::Function>());
-  Nan::AsyncQueueWorker(new greenworks::FilesSaveWorker(success_callback,
-                                                        error_callback,
-                                                        files_path));
+
+  Nan::AsyncQueueWorker(new greenworks::DeltaFileReadWorker(
+      success_callback, error_callback, file_name));
   info.GetReturnValue().Set(Nan::Undefined());
 }
 
@@ -103,9 +469,131 @@ NAN_METHOD(ReadTextFromFile) {
   if (info.Length() > 2 && info[2]->IsFunction())
     error_callback = new Nan::Callback(info[2].As<v8::Function>());
 
-  Nan::AsyncQueueWorker(new greenworks::FileReadWorker(success_callback,
-                                                       error_callback,
-                                                       file_name));
+  CloudFileRead::Start(file_name, 0, -1, true, success_callback,
+                       error_callback);
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(ReadFileFromCloud) {
+  Nan::HandleScope scope;
+
+  if (info.Length() < 2 || !info[0]->IsString()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+
+  // The range options are optional.
+  int callback_index = 1;
+  uint32 offset = 0;
+  int64 length = -1;
+  if (info[1]->IsObject() && !info[1]->IsFunction()) {
+    v8::Local<v8::Object> options = info[1].As<v8::Object>();
+    v8::Local<v8::Value> offset_value =
+        Nan::Get(options, Nan::New("offset").ToLocalChecked())
+            .ToLocalChecked();
+    v8::Local<v8::Value> length_value =
+        Nan::Get(options, Nan::New("length").ToLocalChecked())
+            .ToLocalChecked();
+    if (!offset_value->IsUndefined()) {
+      if (!offset_value->IsUint32())
+        THROW_BAD_ARGS("Bad arguments");
+      offset = Nan::To<uint32>(offset_value).FromJust();
+    }
+    if (!length_value->IsUndefined()) {
+      if (!length_value->IsUint32())
+        THROW_BAD_ARGS("Bad arguments");
+      length = Nan::To<uint32>(length_value).FromJust();
+    }
+    callback_index = 2;
+  }
+
+  if (info.Length() <= callback_index || !info[callback_index]->IsFunction()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+
+  std::string file_name(*(Nan::Utf8String(info[0])));
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[callback_index].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > callback_index + 1 &&
+      info[callback_index + 1]->IsFunction()) {
+    error_callback =
+        new Nan::Callback(info[callback_index + 1].As<v8::Function>());
+  }
+
+  CloudFileRead::Start(file_name, offset, length, false, success_callback,
+                       error_callback);
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(FileWriteStreamOpen) {
+  Nan::HandleScope scope;
+
+  if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsFunction()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+
+  std::string file_name(*(Nan::Utf8String(info[0])));
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[1].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > 2 && info[2]->IsFunction())
+    error_callback = new Nan::Callback(info[2].As<v8::Function>());
+
+  Nan::AsyncQueueWorker(new greenworks::FileWriteStreamOpenWorker(
+      success_callback, error_callback, file_name));
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(FileWriteStreamWriteChunk) {
+  Nan::HandleScope scope;
+
+  if (info.Length() < 3 || !info[0]->IsString() ||
+      !node::Buffer::HasInstance(info[1]) || !info[2]->IsFunction()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+
+  UGCFileWriteStreamHandle_t handle =
+      utils::strToUint64(*(Nan::Utf8String(info[0])));
+  v8::Local<v8::Object> buffer = info[1].As<v8::Object>();
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[2].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > 3 && info[3]->IsFunction())
+    error_callback = new Nan::Callback(info[3].As<v8::Function>());
+
+  // The chunk is written straight from the Buffer's memory, which the worker
+  // keeps alive until it completes.
+  auto* worker = new greenworks::FileWriteStreamWriteWorker(
+      success_callback, error_callback, handle, node::Buffer::Data(buffer),
+      node::Buffer::Length(buffer));
+  worker->SaveToPersistent("chunk", buffer);
+  Nan::AsyncQueueWorker(worker);
+  info.GetReturnValue().Set(Nan::Undefined());
+}
+
+NAN_METHOD(FileWriteStreamClose) {
+  Nan::HandleScope scope;
+
+  if (info.Length() < 3 || !info[0]->IsString() || !info[1]->IsBoolean() ||
+      !info[2]->IsFunction()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+
+  UGCFileWriteStreamHandle_t handle =
+      utils::strToUint64(*(Nan::Utf8String(info[0])));
+  bool cancel = Nan::To<bool>(info[1]).FromJust();
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[2].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > 3 && info[3]->IsFunction())
+    error_callback = new Nan::Callback(info[3].As<v8::Function>());
+
+  Nan::AsyncQueueWorker(new greenworks::FileWriteStreamCloseWorker(
+      success_callback, error_callback, handle, cancel));
   info.GetReturnValue().Set(Nan::Undefined());
 }
 
@@ -173,17 +661,76 @@ NAN_METHOD(GetFileNameAndSize) {
   info.GetReturnValue().Set(result);
 }
 
+NAN_METHOD(ListCloudFiles) {
+  Nan::HandleScope scope;
+  if (info.Length() > 0 && !info[0]->IsString() && !info[0]->IsUndefined()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  // A pattern with wildcards is a glob, otherwise a prefix.
+  std::string pattern;
+  if (info.Length() > 0 && info[0]->IsString())
+    pattern = *(Nan::Utf8String(info[0]));
+  bool is_glob = pattern.find_first_of("*?") != std::string::npos;
+
+  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+  v8::Local<v8::Array> names = Nan::New<v8::Array>();
+  v8::Local<v8::Array> sizes = Nan::New<v8::Array>();
+  v8::Local<v8::Array> timestamps = Nan::New<v8::Array>();
+  v8::Local<v8::Array> persisted = Nan::New<v8::Array>();
+  v8::Local<v8::Array> sync_platforms = Nan::New<v8::Array>();
+  int32 file_count = steam_remote_storage->GetFileCount();
+  uint32_t count = 0;
+  for (int32 i = 0; i < file_count; ++i) {
+    int32 file_size = 0;
+    const char* file_name =
+        steam_remote_storage->GetFileNameAndSize(i, &file_size);
+    if (!file_name)
+      continue;
+    if (is_glob ? !MatchGlob(file_name, pattern.c_str())
+                : strncmp(file_name, pattern.c_str(), pattern.size()) != 0) {
+      continue;
+    }
+    Nan::Set(names, count, Nan::New(file_name).ToLocalChecked());
+    Nan::Set(sizes, count, Nan::New(file_size));
+    Nan::Set(timestamps, count,
+             Nan::New(static_cast<double>(
+                 steam_remote_storage->GetFileTimestamp(file_name))));
+    Nan::Set(persisted, count,
+             Nan::New(steam_remote_storage->FilePersisted(file_name)));
+    Nan::Set(sync_platforms, count,
+             Nan::New(static_cast<uint32>(
+                 steam_remote_storage->GetSyncPlatforms(file_name))));
+    ++count;
+  }
+
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New("names").ToLocalChecked(), names);
+  Nan::Set(result, Nan::New("sizes").ToLocalChecked(), sizes);
+  Nan::Set(result, Nan::New("timestamps").ToLocalChecked(), timestamps);
+  Nan::Set(result, Nan::New("persisted").ToLocalChecked(), persisted);
+  Nan::Set(result, Nan::New("syncPlatforms").ToLocalChecked(), sync_platforms);
+  info.GetReturnValue().Set(result);
+}
+
 void RegisterAPIs(v8::Local<v8::Object> target) {
   SET_FUNCTION("saveTextToFile", SaveTextToFile);
   SET_FUNCTION("deleteFile", DeleteFile);
   SET_FUNCTION("readTextFromFile", ReadTextFromFile);
   SET_FUNCTION("saveFilesToCloud", SaveFilesToCloud);
+  SET_FUNCTION("syncFilesToCloud", SyncFilesToCloud);
+  SET_FUNCTION("saveDeltaFileToCloud", SaveDeltaFileToCloud);
+  SET_FUNCTION("readDeltaFileFromCloud", ReadDeltaFileFromCloud);
+  SET_FUNCTION("readFileFromCloud", ReadFileFromCloud);
+  SET_FUNCTION("_fileWriteStreamOpen", FileWriteStreamOpen);
+  SET_FUNCTION("_fileWriteStreamWriteChunk", FileWriteStreamWriteChunk);
+  SET_FUNCTION("_fileWriteStreamClose", FileWriteStreamClose);
   SET_FUNCTION("isCloudEnabled", IsCloudEnabled);
   SET_FUNCTION("isCloudEnabledForUser", IsCloudEnabledForUser);
   SET_FUNCTION("enableCloud", EnableCloud);
   SET_FUNCTION("getCloudQuota", GetCloudQuota);
   SET_FUNCTION("getFileCount", GetFileCount);
   SET_FUNCTION("getFileNameAndSize", GetFileNameAndSize);
+  SET_FUNCTION("listCloudFiles", ListCloudFiles);
 }
 
 SteamAPIRegistry::Add X(RegisterAPIs);
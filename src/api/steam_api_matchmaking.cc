@@ -1,17 +1,548 @@
+#include <algorithm>
+#include <cstring>
+#include <deque>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "nan.h"
 #include "steam/steam_api.h"
+#include "steam/isteamnetworkingutils.h"
 #include "v8.h"
 
 #include "greenworks_utils.h"
 #include "steam_api_registry.h"
 #include "steam_id.h"
+#include "steam_lobby_data_mirror.h"
+#include "steam_matchmaking_constants.h"
 
 namespace greenworks {
 namespace api {
 namespace {
 
+// Lobby data key used by hosts to publish their ping location.
+const char kDefaultPingLocationKey[] = "ping_location";
+
+// A parsed ping location published by a lobby, cached so that the location
+// string is only parsed again when the lobby publishes a different one.
+struct LobbyPingLocation {
+  std::string location_str;
+  SteamNetworkPingLocation_t location;
+  bool is_valid = false;
+};
+
+std::unordered_map<uint64, LobbyPingLocation> g_lobby_ping_locations;
+
+// How lobby list snapshots estimate and order by ping.
+struct LobbyPingOptions {
+  // The lobby data key holding the host's ping location.
+  std::string key = kDefaultPingLocationKey;
+  // Whether to sort the lobbies by ping, lowest first.
+  bool sort = false;
+};
+
+// Returns the estimated ping in ms from the local host to |lobby_id| based on
+// the ping location stored in its |key| lobby data, or -1 if unknown.
+int EstimateLobbyPing(CSteamID lobby_id, const char* key,
+    std::unordered_map<uint64, LobbyPingLocation>* cache) {
+  const char* location_str = SteamMatchmaking()->GetLobbyData(lobby_id, key);
+  if (!location_str || !*location_str)
+    return -1;
+  LobbyPingLocation& entry = (*cache)[lobby_id.ConvertToUint64()];
+  if (entry.location_str != location_str) {
+    entry.location_str = location_str;
+    entry.is_valid = SteamNetworkingUtils()->ParsePingLocationString(
+        location_str, entry.location);
+  }
+  if (!entry.is_valid)
+    return -1;
+  return SteamNetworkingUtils()->EstimatePingTimeFromLocalHost(entry.location);
+}
+
+// Returns the lobbies of the last RequestLobbyList result.
+std::vector<CSteamID> GetLobbyList() {
+  std::vector<CSteamID> lobbies;
+  ISteamMatchmaking* steam_matchmaking = SteamMatchmaking();
+  while (true) {
+    CSteamID lobby_id =
+        steam_matchmaking->GetLobbyByIndex(static_cast<int>(lobbies.size()));
+    if (!lobby_id.IsValid())
+      break;
+    lobbies.push_back(lobby_id);
+  }
+  return lobbies;
+}
+
+v8::Local<v8::BigInt> NewBigInt(uint64 value) {
+  return v8::BigInt::NewFromUnsigned(v8::Isolate::GetCurrent(), value);
+}
+
+// Converts strings to internalized V8 strings, creating each distinct string
+// only once. Lobby data keys repeat across every lobby of a result, so this
+// keeps a snapshot from allocating the same key strings over and over.
+class InternedStrings {
+ public:
+  v8::Local<v8::String> Get(const std::string& str) {
+    auto it = strings_.find(str);
+    if (it != strings_.end())
+      return it->second;
+    v8::Local<v8::String> result =
+        v8::String::NewFromUtf8(v8::Isolate::GetCurrent(), str.c_str(),
+                                v8::NewStringType::kInternalized)
+            .ToLocalChecked();
+    strings_.emplace(str, result);
+    return result;
+  }
+
+ private:
+  std::unordered_map<std::string, v8::Local<v8::String>> strings_;
+};
+
+// Reads the lobby data of |lobby_id| into an object. Only |keys| are copied
+// if given, otherwise all of the lobby's data.
+v8::Local<v8::Object> GetLobbyDataObject(CSteamID lobby_id,
+                                         const std::vector<std::string>* keys,
+                                         InternedStrings* strings) {
+  ISteamMatchmaking* steam_matchmaking = SteamMatchmaking();
+  v8::Local<v8::Object> data = Nan::New<v8::Object>();
+  if (keys) {
+    for (const auto& key : *keys) {
+      const char* value = steam_matchmaking->GetLobbyData(lobby_id, key.c_str());
+      if (value && *value)
+        Nan::Set(data, strings->Get(key), Nan::New(value).ToLocalChecked());
+    }
+    return data;
+  }
+  char key[k_nMaxLobbyKeyLength];
+  char value[k_cubChatMetadataMax];
+  int data_count = steam_matchmaking->GetLobbyDataCount(lobby_id);
+  for (int i = 0; i < data_count; ++i) {
+    if (!steam_matchmaking->GetLobbyDataByIndex(lobby_id, i, key, sizeof(key),
+                                                value, sizeof(value))) {
+      continue;
+    }
+    Nan::Set(data, strings->Get(key), Nan::New(value).ToLocalChecked());
+  }
+  return data;
+}
+
+// Gathers the ids, member counts, member limits, ping estimates and lobby
+// data of all lobbies of the last RequestLobbyList result in one pass.
+v8::Local<v8::Array> CreateLobbyListSnapshot(
+    const std::vector<std::string>* keys, const LobbyPingOptions& ping) {
+  ISteamMatchmaking* steam_matchmaking = SteamMatchmaking();
+
+  struct LobbyPing {
+    CSteamID lobby_id;
+    int ping;
+  };
+  // Lobbies which are no longer in the result list are dropped from the cache.
+  std::unordered_map<uint64, LobbyPingLocation> cache;
+  std::vector<LobbyPing> lobbies;
+  for (const CSteamID& lobby_id : GetLobbyList()) {
+    auto cached = g_lobby_ping_locations.find(lobby_id.ConvertToUint64());
+    if (cached != g_lobby_ping_locations.end())
+      cache[cached->first] = cached->second;
+    lobbies.push_back({lobby_id, EstimateLobbyPing(lobby_id, ping.key.c_str(),
+                                                   &cache)});
+  }
+  g_lobby_ping_locations.swap(cache);
+
+  if (ping.sort) {
+    // Lobbies without a ping estimate go last.
+    std::stable_sort(lobbies.begin(), lobbies.end(),
+        [](const LobbyPing& a, const LobbyPing& b) {
+          if (a.ping < 0 || b.ping < 0)
+            return a.ping >= 0 && b.ping < 0;
+          return a.ping < b.ping;
+        });
+  }
+
+  InternedStrings strings;
+  v8::Local<v8::String> id_key = strings.Get("steamIDLobby");
+  v8::Local<v8::String> num_members_key = strings.Get("numMembers");
+  v8::Local<v8::String> member_limit_key = strings.Get("memberLimit");
+  v8::Local<v8::String> ping_key = strings.Get("ping");
+  v8::Local<v8::String> data_key = strings.Get("data");
+
+  v8::Local<v8::Array> result =
+      Nan::New<v8::Array>(static_cast<int>(lobbies.size()));
+  for (uint32_t i = 0; i < lobbies.size(); ++i) {
+    CSteamID lobby_id = lobbies[i].lobby_id;
+    v8::Local<v8::Object> lobby = Nan::New<v8::Object>();
+    Nan::Set(lobby, id_key, NewBigInt(lobby_id.ConvertToUint64()));
+    Nan::Set(lobby, num_members_key,
+             Nan::New(steam_matchmaking->GetNumLobbyMembers(lobby_id)));
+    Nan::Set(lobby, member_limit_key,
+             Nan::New(steam_matchmaking->GetLobbyMemberLimit(lobby_id)));
+    if (lobbies[i].ping >= 0)
+      Nan::Set(lobby, ping_key, Nan::New(lobbies[i].ping));
+    else
+      Nan::Set(lobby, ping_key, Nan::Null());
+    Nan::Set(lobby, data_key, GetLobbyDataObject(lobby_id, keys, &strings));
+    Nan::Set(result, i, lobby);
+  }
+  return result;
+}
+
+// Reads the optional |pingKey| and |sortByPing| options.
+bool GetLobbyPingOptions(v8::Local<v8::Object> options,
+                         LobbyPingOptions* ping) {
+  v8::Local<v8::Value> key =
+      Nan::Get(options, Nan::New("pingKey").ToLocalChecked()).ToLocalChecked();
+  if (!key->IsUndefined()) {
+    if (!key->IsString())
+      return false;
+    ping->key = *(Nan::Utf8String(key));
+  }
+  ping->sort = Nan::To<bool>(
+      Nan::Get(options, Nan::New("sortByPing").ToLocalChecked())
+          .ToLocalChecked()).FromJust();
+  return true;
+}
+
+// Gathers the members of |lobby_id| with their persona names and the
+// requested member data |keys| as parallel arrays, indexed by member:
+// |{ steamIDs, names, data: { key: values } }|. Unset member data reads as
+// an empty string, so all arrays keep the same length.
+v8::Local<v8::Object> CreateLobbyMembersSnapshot(
+    CSteamID lobby_id, const std::vector<std::string>& keys) {
+  ISteamMatchmaking* steam_matchmaking = SteamMatchmaking();
+  ISteamFriends* steam_friends = SteamFriends();
+  int num_members = steam_matchmaking->GetNumLobbyMembers(lobby_id);
+
+  v8::Local<v8::Array> steam_ids = Nan::New<v8::Array>(num_members);
+  v8::Local<v8::Array> names = Nan::New<v8::Array>(num_members);
+  std::vector<v8::Local<v8::Array>> columns;
+  columns.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i)
+    columns.push_back(Nan::New<v8::Array>(num_members));
+
+  for (int i = 0; i < num_members; ++i) {
+    CSteamID member_id =
+        steam_matchmaking->GetLobbyMemberByIndex(lobby_id, i);
+    Nan::Set(steam_ids, i, NewBigInt(member_id.ConvertToUint64()));
+    Nan::Set(names, i,
+             Nan::New(steam_friends->GetFriendPersonaName(member_id))
+                 .ToLocalChecked());
+    for (size_t j = 0; j < keys.size(); ++j) {
+      const char* value = steam_matchmaking->GetLobbyMemberData(
+          lobby_id, member_id, keys[j].c_str());
+      Nan::Set(columns[j], i, Nan::New(value ? value : "").ToLocalChecked());
+    }
+  }
+
+  v8::Local<v8::Object> data = Nan::New<v8::Object>();
+  for (size_t i = 0; i < keys.size(); ++i)
+    Nan::Set(data, Nan::New(keys[i]).ToLocalChecked(), columns[i]);
+
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New("steamIDs").ToLocalChecked(), steam_ids);
+  Nan::Set(result, Nan::New("names").ToLocalChecked(), names);
+  Nan::Set(result, Nan::New("data").ToLocalChecked(), data);
+  return result;
+}
+
+// Reads an optional array of strings argument. Returns false if |value| is
+// set but isn't an array of strings.
+bool GetStringArray(v8::Local<v8::Value> value,
+                    std::vector<std::string>* strings) {
+  if (!value->IsArray())
+    return false;
+  v8::Local<v8::Array> array = value.As<v8::Array>();
+  for (uint32_t i = 0; i < array->Length(); ++i) {
+    v8::Local<v8::Value> item = Nan::Get(array, i).ToLocalChecked();
+    if (!item->IsString())
+      return false;
+    strings->push_back(*(Nan::Utf8String(item)));
+  }
+  return true;
+}
+
+// A lobby search filter, applied with the AddRequestLobbyList*Filter APIs.
+struct LobbyFilter {
+  std::string key;
+  std::string string_value;
+  int int_value;
+  ELobbyComparison comparison;
+};
+
+struct LobbySearchOptions {
+  std::vector<LobbyFilter> string_filters;
+  std::vector<LobbyFilter> numerical_filters;
+  std::vector<LobbyFilter> near_value_filters;
+  int slots_available = -1;
+  int distance = -1;
+  int result_count = -1;
+  CSteamID compatible_members_of;
+  bool has_keys = false;
+  std::vector<std::string> keys;
+  LobbyPingOptions ping;
+  uint64 timeout_ms = 0;
+};
+
+// A searchLobbies or requestLobbyList request. Steam only keeps the result of
+// the latest RequestLobbyList call and applies the filters to the next call,
+// so requests are queued and run one after another. Each one tracks its own
+// SteamAPICall_t, so its result is never confused with another request's.
+class LobbySearch {
+ public:
+  // |success_callback| and |error_callback| may be null for requestLobbyList,
+  // whose result is only delivered by the lobby-match-list event.
+  LobbySearch(const LobbySearchOptions& options,
+              Nan::Callback* success_callback,
+              Nan::Callback* error_callback)
+      : options_(options),
+        success_callback_(success_callback),
+        error_callback_(error_callback),
+        timer_(nullptr),
+        api_call_(k_uAPICallInvalid),
+        is_running_(false) {}
+
+  ~LobbySearch() {
+    delete success_callback_;
+    delete error_callback_;
+  }
+
+  // Starts |search|, or queues it behind the request in flight. Returns the
+  // Steam API call if it started right away, k_uAPICallInvalid if queued.
+  static SteamAPICall_t Queue(LobbySearch* search) {
+    // The timeout also covers the time spent waiting in the queue.
+    if (search->options_.timeout_ms > 0) {
+      search->timer_ = new uv_timer_t();
+      search->timer_->data = search;
+      uv_timer_init(uv_default_loop(), search->timer_);
+      uv_timer_start(search->timer_, &LobbySearch::OnTimeout,
+                     search->options_.timeout_ms, 0);
+    }
+    searches_.push_back(search);
+    StartNext();
+    return search->api_call_;
+  }
+
+ private:
+  static void StartNext() {
+    if (is_busy_ || searches_.empty())
+      return;
+    LobbySearch* search = searches_.front();
+    searches_.pop_front();
+    is_busy_ = true;
+    search->is_running_ = true;
+    search->Start();
+  }
+
+  void Start() {
+    ISteamMatchmaking* steam_matchmaking = SteamMatchmaking();
+    for (const auto& filter : options_.string_filters) {
+      steam_matchmaking->AddRequestLobbyListStringFilter(
+          filter.key.c_str(), filter.string_value.c_str(), filter.comparison);
+    }
+    for (const auto& filter : options_.numerical_filters) {
+      steam_matchmaking->AddRequestLobbyListNumericalFilter(
+          filter.key.c_str(), filter.int_value, filter.comparison);
+    }
+    for (const auto& filter : options_.near_value_filters) {
+      steam_matchmaking->AddRequestLobbyListNearValueFilter(filter.key.c_str(),
+                                                            filter.int_value);
+    }
+    if (options_.slots_available >= 0) {
+      steam_matchmaking->AddRequestLobbyListFilterSlotsAvailable(
+          options_.slots_available);
+    }
+    if (options_.distance >= 0) {
+      steam_matchmaking->AddRequestLobbyListDistanceFilter(
+          static_cast<ELobbyDistanceFilter>(options_.distance));
+    }
+    if (options_.result_count >= 0) {
+      steam_matchmaking->AddRequestLobbyListResultCountFilter(
+          options_.result_count);
+    }
+    if (options_.compatible_members_of.IsValid()) {
+      steam_matchmaking->AddRequestLobbyListCompatibleMembersFilter(
+          options_.compatible_members_of);
+    }
+    api_call_ = steam_matchmaking->RequestLobbyList();
+    call_result_.Set(api_call_, this, &LobbySearch::OnLobbyMatchList);
+  }
+
+  void OnLobbyMatchList(LobbyMatchList_t* result, bool io_failure) {
+    Nan::HandleScope scope;
+    if (io_failure) {
+      Finish("Error on searching lobbies: Steam API IO Failure");
+      return;
+    }
+    if (success_callback_) {
+      v8::Local<v8::Value> argv[] = {CreateLobbyListSnapshot(
+          options_.has_keys ? &options_.keys : nullptr, options_.ping)};
+      Nan::AsyncResource resource("greenworks:LobbySearch.OnLobbyMatchList");
+      success_callback_->Call(1, argv, &resource);
+    }
+    Finish(nullptr);
+  }
+
+#if NAUV_UVVERSION < 0x000b17
+  static void OnTimeout(uv_timer_t* handle, int status_code) {
+#else
+  static void OnTimeout(uv_timer_t* handle) {
+#endif
+    auto* search = static_cast<LobbySearch*>(handle->data);
+    if (search->is_running_)
+      search->call_result_.Cancel();
+    Nan::HandleScope scope;
+    search->Finish("Lobby search timed out.");
+  }
+
+  static void OnTimerClosed(uv_handle_t* handle) {
+    delete reinterpret_cast<uv_timer_t*>(handle);
+  }
+
+  // Reports |error_message| if set, then deletes the search and starts the
+  // next one on the next loop iteration. This may run inside the CCallResult
+  // handler, which still uses the search, and lobby-match-list listeners read
+  // Steam's lobby list after it, before another request may replace it.
+  void Finish(const char* error_message) {
+    if (error_message && error_callback_) {
+      v8::Local<v8::Value> argv[] = {
+          Nan::New(error_message).ToLocalChecked()};
+      Nan::AsyncResource resource("greenworks:LobbySearch.Finish");
+      error_callback_->Call(1, argv, &resource);
+    }
+    if (timer_) {
+      uv_timer_stop(timer_);
+      uv_close(reinterpret_cast<uv_handle_t*>(timer_), &OnTimerClosed);
+      timer_ = nullptr;
+    }
+    if (!is_running_)
+      searches_.erase(std::find(searches_.begin(), searches_.end(), this));
+    uv_timer_t* later = new uv_timer_t();
+    later->data = this;
+    uv_timer_init(uv_default_loop(), later);
+    uv_timer_start(later, &LobbySearch::OnFinished, 0, 0);
+  }
+
+#if NAUV_UVVERSION < 0x000b17
+  static void OnFinished(uv_timer_t* handle, int status_code) {
+#else
+  static void OnFinished(uv_timer_t* handle) {
+#endif
+    auto* search = static_cast<LobbySearch*>(handle->data);
+    uv_close(reinterpret_cast<uv_handle_t*>(handle), &OnTimerClosed);
+    if (search->is_running_)
+      is_busy_ = false;
+    delete search;
+    StartNext();
+  }
+
+  LobbySearchOptions options_;
+  Nan::Callback* success_callback_;
+  Nan::Callback* error_callback_;
+  uv_timer_t* timer_;
+  SteamAPICall_t api_call_;
+  // Whether the search has left the queue and called RequestLobbyList.
+  bool is_running_;
+  CCallResult<LobbySearch, LobbyMatchList_t> call_result_;
+
+  // The searches waiting for the one in flight.
+  static std::deque<LobbySearch*> searches_;
+  // Whether a search is in flight, or its result is still being delivered.
+  static bool is_busy_;
+};
+
+std::deque<LobbySearch*> LobbySearch::searches_;
+bool LobbySearch::is_busy_ = false;
+
+// Parses an array of |{ key, value, [comparison] }| filters.
+bool GetLobbyFilters(v8::Local<v8::Object> filters, const char* name,
+                     bool string_value, std::vector<LobbyFilter>* result) {
+  v8::Local<v8::Value> value =
+      Nan::Get(filters, Nan::New(name).ToLocalChecked()).ToLocalChecked();
+  if (value->IsUndefined())
+    return true;
+  if (!value->IsArray())
+    return false;
+  v8::Local<v8::Array> array = value.As<v8::Array>();
+  for (uint32_t i = 0; i < array->Length(); ++i) {
+    v8::Local<v8::Value> item = Nan::Get(array, i).ToLocalChecked();
+    if (!item->IsObject())
+      return false;
+    v8::Local<v8::Object> item_obj = item.As<v8::Object>();
+    v8::Local<v8::Value> key =
+        Nan::Get(item_obj, Nan::New("key").ToLocalChecked()).ToLocalChecked();
+    v8::Local<v8::Value> filter_value =
+        Nan::Get(item_obj, Nan::New("value").ToLocalChecked()).ToLocalChecked();
+    v8::Local<v8::Value> comparison =
+        Nan::Get(item_obj, Nan::New("comparison").ToLocalChecked())
+            .ToLocalChecked();
+    if (!key->IsString() ||
+        (string_value ? !filter_value->IsString() : !filter_value->IsInt32()) ||
+        (!comparison->IsUndefined() && !comparison->IsInt32())) {
+      return false;
+    }
+    LobbyFilter filter;
+    filter.key = *(Nan::Utf8String(key));
+    filter.int_value = 0;
+    if (string_value)
+      filter.string_value = *(Nan::Utf8String(filter_value));
+    else
+      filter.int_value = Nan::To<int32>(filter_value).FromJust();
+    filter.comparison = comparison->IsUndefined()
+        ? k_ELobbyComparisonEqual
+        : static_cast<ELobbyComparison>(Nan::To<int32>(comparison).FromJust());
+    result->push_back(filter);
+  }
+  return true;
+}
+
+// Reads an optional non-negative integer option.
+bool GetIntOption(v8::Local<v8::Object> options, const char* name,
+                  int* result) {
+  v8::Local<v8::Value> value =
+      Nan::Get(options, Nan::New(name).ToLocalChecked()).ToLocalChecked();
+  if (value->IsUndefined())
+    return true;
+  if (!value->IsInt32() || Nan::To<int32>(value).FromJust() < 0)
+    return false;
+  *result = Nan::To<int32>(value).FromJust();
+  return true;
+}
+
+bool GetLobbySearchOptions(v8::Local<v8::Object> filters,
+                           LobbySearchOptions* options) {
+  if (!GetLobbyFilters(filters, "string", true, &options->string_filters) ||
+      !GetLobbyFilters(filters, "numerical", false,
+                       &options->numerical_filters) ||
+      !GetLobbyFilters(filters, "near", false, &options->near_value_filters) ||
+      !GetIntOption(filters, "slotsAvailable", &options->slots_available) ||
+      !GetIntOption(filters, "distance", &options->distance) ||
+      !GetIntOption(filters, "resultCount", &options->result_count)) {
+    return false;
+  }
+  int timeout_ms = 0;
+  if (!GetIntOption(filters, "timeout", &timeout_ms))
+    return false;
+  options->timeout_ms = timeout_ms;
+
+  v8::Local<v8::Value> compatible_members_of =
+      Nan::Get(filters, Nan::New("compatibleMembersOf").ToLocalChecked())
+          .ToLocalChecked();
+  if (!compatible_members_of->IsUndefined()) {
+    if (!compatible_members_of->IsString())
+      return false;
+    options->compatible_members_of = CSteamID(utils::strToUint64(
+        *(Nan::Utf8String(compatible_members_of))));
+  }
+
+  v8::Local<v8::Value> keys =
+      Nan::Get(filters, Nan::New("keys").ToLocalChecked()).ToLocalChecked();
+  if (!keys->IsUndefined()) {
+    if (!GetStringArray(keys, &options->keys))
+      return false;
+    options->has_keys = true;
+  }
+  return GetLobbyPingOptions(filters, &options->ping);
+}
+
 void InitChatMemberStateChange(v8::Local<v8::Object> exports) {
   v8::Local<v8::Object> chat_member_state_change = Nan::New<v8::Object>();
   SET_TYPE(chat_member_state_change, "Entered", k_EChatMemberStateChangeEntered);
@@ -400,9 +931,124 @@ NAN_METHOD(RequestLobbyList) {
   if (info.Length() > 0) {
     THROW_BAD_ARGS("Bad arguments");
   }
+  // Queued with the searchLobbies requests, so that neither replaces the
+  // other's results.
+  SteamAPICall_t api_call = LobbySearch::Queue(
+      new LobbySearch(LobbySearchOptions(), nullptr, nullptr));
   info.GetReturnValue().Set(
-      Nan::New(utils::uint64ToString(SteamMatchmaking()->RequestLobbyList()))
-          .ToLocalChecked());
+      Nan::New(utils::uint64ToString(api_call)).ToLocalChecked());
+}
+
+NAN_METHOD(SetLobbyPingLocation) {
+  Nan::HandleScope scope;
+  if (info.Length() < 1 || !info[0]->IsString()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  std::string steam_id_str(*(Nan::Utf8String(info[0])));
+  CSteamID steam_id(utils::strToUint64(steam_id_str));
+  if (!steam_id.IsValid()) {
+    THROW_BAD_ARGS("Steam ID is invalid");
+  }
+  std::string key = kDefaultPingLocationKey;
+  if (info.Length() > 1 && info[1]->IsString())
+    key = *(Nan::Utf8String(info[1]));
+
+  SteamNetworkPingLocation_t location;
+  if (SteamNetworkingUtils()->GetLocalPingLocation(location) < 0) {
+    info.GetReturnValue().Set(false);
+    return;
+  }
+  char location_str[k_cchMaxSteamNetworkingPingLocationString];
+  SteamNetworkingUtils()->ConvertPingLocationToString(location, location_str,
+                                                      sizeof(location_str));
+  info.GetReturnValue().Set(
+      SteamMatchmaking()->SetLobbyData(steam_id, key.c_str(), location_str));
+}
+
+NAN_METHOD(GetLobbyListSnapshot) {
+  Nan::HandleScope scope;
+  std::vector<std::string> keys;
+  bool has_keys = info.Length() > 0 && !info[0]->IsUndefined();
+  if (has_keys && !GetStringArray(info[0], &keys)) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  LobbyPingOptions ping;
+  if (info.Length() > 1 && !info[1]->IsUndefined() &&
+      (!info[1]->IsObject() ||
+       !GetLobbyPingOptions(info[1].As<v8::Object>(), &ping))) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  info.GetReturnValue().Set(
+      CreateLobbyListSnapshot(has_keys ? &keys : nullptr, ping));
+}
+
+NAN_METHOD(WatchLobbyData) {
+  Nan::HandleScope scope;
+  if (info.Length() < 1 || !info[0]->IsString()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  std::string steam_id_str(*(Nan::Utf8String(info[0])));
+  CSteamID steam_id(utils::strToUint64(steam_id_str));
+  if (!steam_id.IsValid()) {
+    THROW_BAD_ARGS("Steam ID is invalid");
+  }
+  std::vector<std::string> member_keys;
+  if (info.Length() > 1 && !info[1]->IsUndefined() &&
+      !GetStringArray(info[1], &member_keys)) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  greenworks::LobbyDataMirror::GetInstance()->Watch(steam_id, member_keys);
+}
+
+NAN_METHOD(UnwatchLobbyData) {
+  Nan::HandleScope scope;
+  if (info.Length() < 1 || !info[0]->IsString()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  std::string steam_id_str(*(Nan::Utf8String(info[0])));
+  CSteamID steam_id(utils::strToUint64(steam_id_str));
+  info.GetReturnValue().Set(
+      greenworks::LobbyDataMirror::GetInstance()->Unwatch(steam_id));
+}
+
+NAN_METHOD(GetLobbyMembersSnapshot) {
+  Nan::HandleScope scope;
+  if (info.Length() < 1 || !info[0]->IsString()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  std::string steam_id_str(*(Nan::Utf8String(info[0])));
+  CSteamID steam_id(utils::strToUint64(steam_id_str));
+  if (!steam_id.IsValid()) {
+    THROW_BAD_ARGS("Steam ID is invalid");
+  }
+  std::vector<std::string> keys;
+  if (info.Length() > 1 && !info[1]->IsUndefined() &&
+      !GetStringArray(info[1], &keys)) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  info.GetReturnValue().Set(CreateLobbyMembersSnapshot(steam_id, keys));
+}
+
+NAN_METHOD(SearchLobbies) {
+  Nan::HandleScope scope;
+  if (info.Length() < 2 || !info[0]->IsObject() || !info[1]->IsFunction()) {
+    THROW_BAD_ARGS("Bad arguments");
+  }
+  LobbySearchOptions options;
+  if (!GetLobbySearchOptions(info[0].As<v8::Object>(), &options)) {
+    THROW_BAD_ARGS("Bad lobby search filters");
+  }
+
+  Nan::Callback* success_callback =
+      new Nan::Callback(info[1].As<v8::Function>());
+  Nan::Callback* error_callback = nullptr;
+
+  if (info.Length() > 2 && info[2]->IsFunction())
+    error_callback = new Nan::Callback(info[2].As<v8::Function>());
+
+  LobbySearch::Queue(
+      new LobbySearch(options, success_callback, error_callback));
+  info.GetReturnValue().Set(Nan::Undefined());
 }
 
 NAN_METHOD(GetLobbyMemberLimit) {
@@ -571,9 +1217,10 @@ NAN_METHOD(GetLobbyChatEntry) {
   CSteamID steamIDLobby(static_cast<uint64>(std::stoull(lobbyIdStr)));
 
   int iChatID = info[1]->Int32Value(Nan::GetCurrentContext()).FromJust();
+  bool as_buffer = info.Length() > 2 && info[2]->IsTrue();
 
   CSteamID steamIDUser;
-  char dataBuffer[4096];
+  char dataBuffer[kMaxLobbyChatMsgSize];
   int cubData = sizeof(dataBuffer);
   EChatEntryType chatEntryType;
 
@@ -585,12 +1232,20 @@ NAN_METHOD(GetLobbyChatEntry) {
     return;
   }
 
+  v8::Local<v8::Value> data;
+  if (as_buffer) {
+    data = Nan::CopyBuffer(dataBuffer, result).ToLocalChecked();
+  } else {
+    // The entry isn't NUL-terminated if it fills the whole buffer.
+    data = Nan::New(dataBuffer, static_cast<int>(strnlen(dataBuffer, result)))
+               .ToLocalChecked();
+  }
+
   v8::Local<v8::Object> resultObj = Nan::New<v8::Object>();
   Nan::Set(
       resultObj, Nan::New("steamIDUser").ToLocalChecked(),
       Nan::New(std::to_string(steamIDUser.ConvertToUint64())).ToLocalChecked());
-  Nan::Set(resultObj, Nan::New("data").ToLocalChecked(),
-           Nan::New(dataBuffer).ToLocalChecked());
+  Nan::Set(resultObj, Nan::New("data").ToLocalChecked(), data);
   Nan::Set(resultObj, Nan::New("chatEntryType").ToLocalChecked(),
            Nan::New(chatEntryType));
 
@@ -620,6 +1275,12 @@ void RegisterAPIs(v8::Local<v8::Object> target) {
   SET_FUNCTION("setLobbyType", SetLobbyType);
 
   SET_FUNCTION("requestLobbyList", RequestLobbyList);
+  SET_FUNCTION("setLobbyPingLocation", SetLobbyPingLocation);
+  SET_FUNCTION("getLobbyListSnapshot", GetLobbyListSnapshot);
+  SET_FUNCTION("watchLobbyData", WatchLobbyData);
+  SET_FUNCTION("unwatchLobbyData", UnwatchLobbyData);
+  SET_FUNCTION("getLobbyMembersSnapshot", GetLobbyMembersSnapshot);
+  SET_FUNCTION("_searchLobbies", SearchLobbies);
   SET_FUNCTION("getLobbyMemberLimit", GetLobbyMemberLimit);
   SET_FUNCTION("setLobbyMemberLimit", SetLobbyMemberLimit);
   SET_FUNCTION("getLobbyMemberData", GetLobbyMemberData);
@@ -2,7 +2,12 @@
 // Use of this source code is governed by the MIT license that can be
 // found in the LICENSE file.
 
+#include <cstdlib>
+#include <deque>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "nan.h"
 #include "steam/steam_api.h"
@@ -18,6 +23,153 @@ namespace greenworks {
 namespace api {
 namespace {
 
+// Config values converted into the SteamNetworkingConfigValue_t array that the
+// connect/listen APIs take. String values are owned by |strings| so that the
+// pointers stored in |values| stay valid as long as this object is alive.
+struct ConfigOptions {
+  std::vector<SteamNetworkingConfigValue_t> values;
+  std::deque<std::string> strings;
+};
+
+// Precompiled config profiles created by createNetworkingConfigProfile.
+std::map<uint32, std::unique_ptr<ConfigOptions>> g_config_profiles;
+uint32 g_next_config_profile_id = 1;
+
+// Converts an object of |{ [NetworkingConfigValue.X]: value }| pairs into
+// |options|. The data type of each value is looked up from the Steam SDK, so
+// callers don't have to know whether a config value is an int or a float.
+bool ParseConfigOptions(v8::Local<v8::Object> object, ConfigOptions* options,
+                        std::string* error) {
+  v8::Local<v8::Array> keys = Nan::GetOwnPropertyNames(object).ToLocalChecked();
+  options->values.reserve(keys->Length());
+  for (uint32_t i = 0; i < keys->Length(); ++i) {
+    v8::Local<v8::Value> key = Nan::Get(keys, i).ToLocalChecked();
+    std::string key_str(*(Nan::Utf8String(key)));
+    char* end = nullptr;
+    long config_id = std::strtol(key_str.c_str(), &end, 10);  // NOLINT
+    if (key_str.empty() || *end != '\0') {
+      *error = "Config value key must be a NetworkingConfigValue: " + key_str;
+      return false;
+    }
+    auto config_value = static_cast<ESteamNetworkingConfigValue>(config_id);
+    ESteamNetworkingConfigDataType data_type;
+    ESteamNetworkingConfigScope config_scope;
+    if (!SteamNetworkingUtils()->GetConfigValueInfo(config_value, &data_type,
+                                                    &config_scope)) {
+      *error = "Unknown config value: " + key_str;
+      return false;
+    }
+
+    v8::Local<v8::Value> value = Nan::Get(object, key).ToLocalChecked();
+    SteamNetworkingConfigValue_t entry;
+    switch (data_type) {
+      case k_ESteamNetworkingConfig_Int32:
+        if (!value->IsNumber() && !value->IsBoolean())
+          break;
+        entry.SetInt32(config_value, Nan::To<int32_t>(value).FromJust());
+        options->values.push_back(entry);
+        continue;
+      case k_ESteamNetworkingConfig_Int64:
+        if (!value->IsNumber())
+          break;
+        entry.SetInt64(config_value, Nan::To<int64_t>(value).FromJust());
+        options->values.push_back(entry);
+        continue;
+      case k_ESteamNetworkingConfig_Float:
+        if (!value->IsNumber())
+          break;
+        entry.SetFloat(config_value,
+                       static_cast<float>(Nan::To<double>(value).FromJust()));
+        options->values.push_back(entry);
+        continue;
+      case k_ESteamNetworkingConfig_String:
+        if (!value->IsString())
+          break;
+        options->strings.push_back(*(Nan::Utf8String(value)));
+        entry.SetString(config_value, options->strings.back().c_str());
+        options->values.push_back(entry);
+        continue;
+      default:
+        *error = "Config value is not settable from JavaScript: " + key_str;
+        return false;
+    }
+    *error = "Bad value type for config value: " + key_str;
+    return false;
+  }
+  return true;
+}
+
+// Resolves the optional options argument at |index|, which is either a config
+// profile id or an object of config values. |temp| holds the conversion of an
+// inline object. Throws and returns false on bad arguments.
+bool GetConfigOptionsArg(const Nan::FunctionCallbackInfo<v8::Value>& info,
+                         int index,
+                         ConfigOptions* temp,
+                         const ConfigOptions** result) {
+  *result = nullptr;
+  if (info.Length() <= index || info[index]->IsUndefined() ||
+      info[index]->IsNull()) {
+    return true;
+  }
+  if (info[index]->IsUint32()) {
+    auto it = g_config_profiles.find(Nan::To<uint32_t>(info[index]).FromJust());
+    if (it == g_config_profiles.end()) {
+      Nan::ThrowTypeError("Unknown networking config profile");
+      return false;
+    }
+    *result = it->second.get();
+    return true;
+  }
+  if (!info[index]->IsObject()) {
+    Nan::ThrowTypeError("Options must be a config profile or an object");
+    return false;
+  }
+  std::string error;
+  if (!ParseConfigOptions(info[index].As<v8::Object>(), temp, &error)) {
+    Nan::ThrowTypeError(error.c_str());
+    return false;
+  }
+  *result = temp;
+  return true;
+}
+
+int GetConfigOptionsCount(const ConfigOptions* options) {
+  return options ? static_cast<int>(options->values.size()) : 0;
+}
+
+const SteamNetworkingConfigValue_t* GetConfigOptionsData(
+    const ConfigOptions* options) {
+  return options && !options->values.empty() ? options->values.data()
+                                             : nullptr;
+}
+
+// Config profiles
+
+NAN_METHOD(CreateNetworkingConfigProfile) {
+  Nan::HandleScope scope;
+  if (info.Length() < 1 || !info[0]->IsObject()) {
+    THROW_BAD_ARGS("Bad arguments: config values object required");
+  }
+
+  std::unique_ptr<ConfigOptions> options(new ConfigOptions());
+  std::string error;
+  if (!ParseConfigOptions(info[0].As<v8::Object>(), options.get(), &error)) {
+    THROW_BAD_ARGS(error.c_str());
+  }
+  uint32 profile_id = g_next_config_profile_id++;
+  g_config_profiles[profile_id] = std::move(options);
+  info.GetReturnValue().Set(Nan::New(profile_id));
+}
+
+NAN_METHOD(DeleteNetworkingConfigProfile) {
+  Nan::HandleScope scope;
+  if (info.Length() < 1 || !info[0]->IsUint32()) {
+    THROW_BAD_ARGS("Bad arguments: config profile required");
+  }
+  info.GetReturnValue().Set(Nan::New(
+      g_config_profiles.erase(Nan::To<uint32_t>(info[0]).FromJust()) > 0));
+}
+
 // Connection management
 
 NAN_METHOD(CreateListenSocketIP) {
@@ -32,11 +184,14 @@ NAN_METHOD(CreateListenSocketIP) {
   localAddress.Clear();
   localAddress.m_port = port;
   
-  int nOptions = 0;
-  const SteamNetworkingConfigValue_t *pOptions = nullptr;
+  ConfigOptions inline_options;
+  const ConfigOptions* options = nullptr;
+  if (!GetConfigOptionsArg(info, 1, &inline_options, &options))
+    return;
   
   HSteamListenSocket hSocket = SteamNetworkingSockets()->CreateListenSocketIP(
-      localAddress, nOptions, pOptions);
+      localAddress, GetConfigOptionsCount(options),
+      GetConfigOptionsData(options));
   
   if (hSocket == k_HSteamListenSocket_Invalid) {
     info.GetReturnValue().Set(Nan::New(0));
@@ -60,11 +215,13 @@ NAN_METHOD(ConnectByIPAddress) {
   }
   address.m_port = port;
   
-  int nOptions = 0;
-  const SteamNetworkingConfigValue_t *pOptions = nullptr;
+  ConfigOptions inline_options;
+  const ConfigOptions* options = nullptr;
+  if (!GetConfigOptionsArg(info, 2, &inline_options, &options))
+    return;
   
   HSteamNetConnection hConn = SteamNetworkingSockets()->ConnectByIPAddress(
-      address, nOptions, pOptions);
+      address, GetConfigOptionsCount(options), GetConfigOptionsData(options));
   
   if (hConn == k_HSteamNetConnection_Invalid) {
     info.GetReturnValue().Set(Nan::New(0));
@@ -93,11 +250,14 @@ NAN_METHOD(ConnectP2P) {
     nVirtualPort = info[1]->Int32Value(Nan::GetCurrentContext()).FromJust();
   }
   
-  int nOptions = 0;
-  const SteamNetworkingConfigValue_t *pOptions = nullptr;
+  ConfigOptions inline_options;
+  const ConfigOptions* options = nullptr;
+  if (!GetConfigOptionsArg(info, 2, &inline_options, &options))
+    return;
   
   HSteamNetConnection hConn = SteamNetworkingSockets()->ConnectP2P(
-      identity, nVirtualPort, nOptions, pOptions);
+      identity, nVirtualPort, GetConfigOptionsCount(options),
+      GetConfigOptionsData(options));
   
   if (hConn == k_HSteamNetConnection_Invalid) {
     info.GetReturnValue().Set(Nan::New(0));
@@ -377,6 +537,10 @@ void RegisterAPIs(v8::Local<v8::Object> target) {
   SET_FUNCTION("closeConnection", CloseConnection);
   SET_FUNCTION("closeListenSocket", CloseListenSocket);
   
+  // Config profiles
+  SET_FUNCTION("createNetworkingConfigProfile", CreateNetworkingConfigProfile);
+  SET_FUNCTION("deleteNetworkingConfigProfile", DeleteNetworkingConfigProfile);
+  
   // Message sending/receiving
   SET_FUNCTION("sendMessageToConnection", SendMessageToConnection);
   SET_FUNCTION("receiveMessagesOnConnection", ReceiveMessagesOnConnection);
@@ -267,6 +267,77 @@ NAN_METHOD(GetDirectPingToPOP) {
   }
 }
 
+NAN_METHOD(GetLocalPingLocation) {
+  Nan::HandleScope scope;
+  
+  SteamNetworkPingLocation_t location;
+  float age = SteamNetworkingUtils()->GetLocalPingLocation(location);
+  if (age < 0) {
+    info.GetReturnValue().Set(Nan::Null());
+    return;
+  }
+  
+  char szLocation[k_cchMaxSteamNetworkingPingLocationString];
+  SteamNetworkingUtils()->ConvertPingLocationToString(
+      location, szLocation, sizeof(szLocation));
+  
+  v8::Local<v8::Object> resultObj = Nan::New<v8::Object>();
+  Nan::Set(resultObj, Nan::New("location").ToLocalChecked(),
+           Nan::New(szLocation).ToLocalChecked());
+  Nan::Set(resultObj, Nan::New("age").ToLocalChecked(), Nan::New(age));
+  
+  info.GetReturnValue().Set(resultObj);
+}
+
+NAN_METHOD(EstimatePingTimeBetweenTwoLocations) {
+  Nan::HandleScope scope;
+  if (info.Length() < 2 || !info[0]->IsString() || !info[1]->IsString()) {
+    THROW_BAD_ARGS("Bad arguments: two ping location strings required");
+  }
+  
+  std::string location1_str(*(Nan::Utf8String(info[0])));
+  std::string location2_str(*(Nan::Utf8String(info[1])));
+  SteamNetworkPingLocation_t location1;
+  SteamNetworkPingLocation_t location2;
+  if (!SteamNetworkingUtils()->ParsePingLocationString(location1_str.c_str(),
+                                                       location1) ||
+      !SteamNetworkingUtils()->ParsePingLocationString(location2_str.c_str(),
+                                                       location2)) {
+    THROW_BAD_ARGS("Invalid ping location string");
+  }
+  
+  int ping = SteamNetworkingUtils()->EstimatePingTimeBetweenTwoLocations(
+      location1, location2);
+  
+  if (ping < 0) {
+    info.GetReturnValue().Set(Nan::Null());
+  } else {
+    info.GetReturnValue().Set(Nan::New(ping));
+  }
+}
+
+NAN_METHOD(EstimatePingTimeFromLocalHost) {
+  Nan::HandleScope scope;
+  if (info.Length() < 1 || !info[0]->IsString()) {
+    THROW_BAD_ARGS("Bad arguments: ping location string required");
+  }
+  
+  std::string location_str(*(Nan::Utf8String(info[0])));
+  SteamNetworkPingLocation_t location;
+  if (!SteamNetworkingUtils()->ParsePingLocationString(location_str.c_str(),
+                                                       location)) {
+    THROW_BAD_ARGS("Invalid ping location string");
+  }
+  
+  int ping = SteamNetworkingUtils()->EstimatePingTimeFromLocalHost(location);
+  
+  if (ping < 0) {
+    info.GetReturnValue().Set(Nan::Null());
+  } else {
+    info.GetReturnValue().Set(Nan::New(ping));
+  }
+}
+
 NAN_METHOD(GetPOPCount) {
   Nan::HandleScope scope;
   int count = SteamNetworkingUtils()->GetPOPCount();
@@ -318,6 +389,10 @@ void RegisterAPIs(v8::Local<v8::Object> target) {
   
   // Ping/Location
   SET_FUNCTION("checkPingDataUpToDate", CheckPingDataUpToDate);
+  SET_FUNCTION("getLocalPingLocation", GetLocalPingLocation);
+  SET_FUNCTION("estimatePingTimeBetweenTwoLocations",
+               EstimatePingTimeBetweenTwoLocations);
+  SET_FUNCTION("estimatePingTimeFromLocalHost", EstimatePingTimeFromLocalHost);
   SET_FUNCTION("getPingToDataCenter", GetPingToDataCenter);
   SET_FUNCTION("getDirectPingToPOP", GetDirectPingToPOP);
   SET_FUNCTION("getPOPCount", GetPOPCount);
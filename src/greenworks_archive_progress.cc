@@ -0,0 +1,65 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "greenworks_archive_progress.h"
+
+namespace greenworks {
+
+namespace {
+
+// Keeps the progress events of a busy job to a few per frame of UI.
+const std::chrono::milliseconds kArchiveProgressInterval(100);
+
+}  // namespace
+
+ArchiveProgressTracker::ArchiveProgressTracker(
+    const ArchiveProgressCallback& callback, const std::atomic<bool>* cancel)
+    : callback_(callback),
+      cancel_(cancel),
+      last_report_(std::chrono::steady_clock::now()) {
+}
+
+void ArchiveProgressTracker::SetTotals(uint64_t total_bytes,
+                                       uint64_t total_entries) {
+  total_bytes_ = total_bytes;
+  total_entries_ = total_entries;
+}
+
+void ArchiveProgressTracker::AddBytes(uint64_t bytes) {
+  bytes_ += bytes;
+  Report(false);
+}
+
+void ArchiveProgressTracker::AddEntry() {
+  ++entries_;
+  Report(false);
+}
+
+void ArchiveProgressTracker::Finish() {
+  Report(true);
+}
+
+void ArchiveProgressTracker::Report(bool force) {
+  if (!callback_)
+    return;
+  // The threads that find a report in progress leave it to that one.
+  std::unique_lock<std::mutex> lock(mutex_, std::defer_lock);
+  if (force)
+    lock.lock();
+  else if (!lock.try_lock())
+    return;
+  auto now = std::chrono::steady_clock::now();
+  if (!force && now - last_report_ < kArchiveProgressInterval)
+    return;
+  last_report_ = now;
+
+  ArchiveProgress progress;
+  progress.bytes = bytes_;
+  progress.total_bytes = total_bytes_;
+  progress.entries = entries_;
+  progress.total_entries = total_entries_;
+  callback_(progress);
+}
+
+}  // namespace greenworks
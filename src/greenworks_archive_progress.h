@@ -0,0 +1,60 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#ifndef SRC_GREENWORKS_ARCHIVE_PROGRESS_H_
+#define SRC_GREENWORKS_ARCHIVE_PROGRESS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace greenworks {
+
+// Returned by zip and unzip jobs stopped through their |cancel| flag.
+const int kArchiveCancelled = -1000;
+
+// The work done so far by a zip or unzip job. |bytes| counts uncompressed
+// data.
+struct ArchiveProgress {
+  uint64_t bytes = 0;
+  uint64_t total_bytes = 0;
+  uint64_t entries = 0;
+  uint64_t total_entries = 0;
+};
+
+typedef std::function<void(const ArchiveProgress&)> ArchiveProgressCallback;
+
+// Counts the progress of a job from any of its threads, and reports it to
+// |callback| at most every |kArchiveProgressInterval|, then once on Finish.
+// Reports are serialized and in order.
+class ArchiveProgressTracker {
+ public:
+  ArchiveProgressTracker(const ArchiveProgressCallback& callback,
+                         const std::atomic<bool>* cancel);
+
+  void SetTotals(uint64_t total_bytes, uint64_t total_entries);
+  void AddBytes(uint64_t bytes);
+  void AddEntry();
+  void Finish();
+
+  bool cancelled() const { return cancel_ != nullptr && *cancel_; }
+
+ private:
+  void Report(bool force);
+
+  const ArchiveProgressCallback& callback_;
+  const std::atomic<bool>* cancel_;
+  uint64_t total_bytes_ = 0;
+  uint64_t total_entries_ = 0;
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<uint64_t> entries_{0};
+  std::mutex mutex_;
+  std::chrono::steady_clock::time_point last_report_;
+};
+
+}  // namespace greenworks
+
+#endif  // SRC_GREENWORKS_ARCHIVE_PROGRESS_H_
@@ -4,133 +4,666 @@
 
 #include "greenworks_async_workers.h"
 
-#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
 #include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
 #include "nan.h"
 #include "steam/steam_api.h"
 #include "v8.h"
 
+#include "greenworks_cloud_compression.h"
+#include "greenworks_cloud_delta.h"
 #include "greenworks_unzip.h"
 #include "greenworks_zip.h"
 
 
 namespace {
 
-struct FilesContentContainer {
-  std::vector<char*> files_content;
-  ~FilesContentContainer() {
-    for (size_t i = 0; i < files_content.size(); ++i) {
-      delete[] files_content[i];
+// A file read by FilesSaveWorker, waiting to be written to Steam Cloud.
+struct FileContent {
+  size_t index = 0;
+  bool is_read = false;
+  std::string content;
+};
+
+// A file's entry in the manifest of FilesSyncWorker.
+struct SyncManifestEntry {
+  int64 size = -1;
+  int64 mtime = -1;
+  uint64 hash = 0;
+  int64 cloud_timestamp = -1;
+};
+
+typedef std::map<std::string, SyncManifestEntry> SyncManifest;
+
+// Loads a manifest written by SaveSyncManifest. One line per cloud file:
+// "name\tsize\tmtime\thash\tcloud_timestamp". A missing manifest is empty.
+void LoadSyncManifest(const std::string& path, SyncManifest* manifest) {
+  std::ifstream fin(path.c_str());
+  std::string line;
+  while (std::getline(fin, line)) {
+    std::istringstream fields(line);
+    std::string name;
+    SyncManifestEntry entry;
+    if (std::getline(fields, name, '\t') &&
+        fields >> entry.size >> entry.mtime >> std::hex >> entry.hash >>
+            std::dec >> entry.cloud_timestamp) {
+      (*manifest)[name] = entry;
     }
   }
-};
+}
+
+// Reads a whole cloud file. Returns false if it doesn't exist.
+bool ReadCloudFile(const std::string& file_name, std::string* content) {
+  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+  if (!steam_remote_storage->FileExists(file_name.c_str()))
+    return false;
+  int32 file_size = steam_remote_storage->GetFileSize(file_name.c_str());
+  content->resize(file_size);
+  return file_size == 0 ||
+         steam_remote_storage->FileRead(file_name.c_str(), &(*content)[0],
+                                        file_size) == file_size;
+}
+
+bool SaveSyncManifest(const std::string& path, const SyncManifest& manifest) {
+  std::ofstream fout(path.c_str(), std::ios::out | std::ios::trunc);
+  for (const auto& item : manifest) {
+    fout << item.first << '\t' << item.second.size << '\t'
+         << item.second.mtime << '\t' << std::hex << item.second.hash
+         << std::dec << '\t' << item.second.cloud_timestamp << '\n';
+  }
+  return fout.good();
+}
+
+// Copies |values| into a new |ArrayType| (e.g. v8::Float64Array) of
+// |Element|s, backed by the memory of a Buffer.
+template <typename ArrayType, typename Element, typename T>
+v8::Local<ArrayType> NewTypedArray(const std::vector<T>& values) {
+  size_t bytes = values.size() * sizeof(Element);
+  auto* data = static_cast<Element*>(malloc(bytes ? bytes : 1));
+  for (size_t i = 0; i < values.size(); ++i)
+    data[i] = static_cast<Element>(values[i]);
+  v8::Local<v8::Object> buffer =
+      Nan::NewBuffer(reinterpret_cast<char*>(data),
+                     static_cast<uint32_t>(bytes)).ToLocalChecked();
+  return ArrayType::New(buffer.As<v8::Uint8Array>()->Buffer(), 0,
+                        values.size());
+}
+
+// Whether |size| bytes fit in a Buffer. Larger sizes would be truncated by
+// the uint32_t length Nan::NewBuffer takes.
+bool FitsInBuffer(uint64 size) {
+  return size <= node::Buffer::kMaxLength;
+}
+
+// Passes the latest of a batch of archive progress events to |callback|, the
+// earlier ones being stale by the time the batch is delivered.
+void CallArchiveProgressCallback(Nan::Callback* callback,
+                                 const greenworks::ArchiveProgress* data,
+                                 size_t count, const char* resource_name) {
+  if (!callback || count == 0)
+    return;
+  Nan::HandleScope scope;
+  const greenworks::ArchiveProgress& progress = data[count - 1];
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New("bytes").ToLocalChecked(),
+           Nan::New(static_cast<double>(progress.bytes)));
+  Nan::Set(result, Nan::New("totalBytes").ToLocalChecked(),
+           Nan::New(static_cast<double>(progress.total_bytes)));
+  Nan::Set(result, Nan::New("entries").ToLocalChecked(),
+           Nan::New(static_cast<double>(progress.entries)));
+  Nan::Set(result, Nan::New("totalEntries").ToLocalChecked(),
+           Nan::New(static_cast<double>(progress.total_entries)));
+  v8::Local<v8::Value> argv[] = { result };
+  Nan::AsyncResource resource(resource_name);
+  callback->Call(1, argv, &resource);
+}
 
 };  // namespace
 
 namespace greenworks {
 
 FileContentSaveWorker::FileContentSaveWorker(Nan::Callback* success_callback,
-    Nan::Callback* error_callback, std::string file_name, std::string content):
+    Nan::Callback* error_callback, std::string file_name, std::string content,
+    bool compress):
         SteamAsyncWorker(success_callback, error_callback),
         file_name_(file_name),
-        content_(content) {
+        content_(content),
+        compress_(compress) {
 }
 
 void FileContentSaveWorker::Execute() {
+  if (compress_) {
+    std::string compressed;
+    if (!CompressCloudFile(content_.data(), content_.size(),
+                           kDefaultCloudCompressionLevel,
+                           [&](const char* data, size_t length) {
+                             compressed.append(data, length);
+                             return true;
+                           })) {
+      SetErrorMessage("Error on compressing file.");
+      return;
+    }
+    content_.swap(compressed);
+  }
   if (!SteamRemoteStorage()->FileWrite(
       file_name_.c_str(), content_.c_str(), content_.size()))
     SetErrorMessage("Error on writing to file.");
 }
 
 FilesSaveWorker::FilesSaveWorker(Nan::Callback* success_callback,
-    Nan::Callback* error_callback, const std::vector<std::string>& files_path):
+    Nan::Callback* error_callback, Nan::Callback* progress_callback,
+    const std::vector<std::string>& files_path, size_t max_bytes_in_flight,
+    bool compress):
+        SteamAsyncProgressWorker(success_callback, error_callback,
+                                 progress_callback),
+        files_path_(files_path),
+        max_bytes_in_flight_(max_bytes_in_flight),
+        compress_(compress) {
+}
+
+void FilesSaveWorker::Execute(const ExecutionProgress& progress) {
+  std::mutex mutex;
+  std::condition_variable queue_changed;
+  std::deque<FileContent> queue;
+  size_t bytes_in_flight = 0;
+
+  // Reads the files in order, waiting before each one until it fits into the
+  // budget. A file larger than the whole budget is read once nothing else is
+  // in memory.
+  std::thread reader([&] {
+    for (size_t i = 0; i < files_path_.size(); ++i) {
+      FileContent file;
+      file.index = i;
+      std::ifstream fin(files_path_[i].c_str(),
+                        std::ios::in | std::ios::binary | std::ios::ate);
+      size_t size = fin.is_open() ? static_cast<size_t>(fin.tellg()) : 0;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        queue_changed.wait(lock, [&] {
+          return bytes_in_flight == 0 ||
+                 bytes_in_flight + size <= max_bytes_in_flight_;
+        });
+        bytes_in_flight += size;
+      }
+      if (fin.is_open()) {
+        file.content.resize(size);
+        fin.seekg(0, std::ios::beg);
+        file.is_read = static_cast<bool>(fin.read(&file.content[0], size));
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.push_back(std::move(file));
+      queue_changed.notify_all();
+    }
+  });
+
+  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+  steam_remote_storage->BeginFileWriteBatch();
+  size_t failed_count = 0;
+  for (size_t i = 0; i < files_path_.size(); ++i) {
+    FileContent file;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      queue_changed.wait(lock, [&] { return !queue.empty(); });
+      file = std::move(queue.front());
+      queue.pop_front();
+    }
+
+    FileSaveProgress result;
+    result.index = file.index;
+    std::string file_name = utils::GetFileNameFromPath(files_path_[file.index]);
+    if (!file.is_read) {
+      result.error = "Error on reading file.";
+    } else if (compress_) {
+      // The compressed content is streamed to Steam as it's produced.
+      UGCFileWriteStreamHandle_t handle =
+          steam_remote_storage->FileWriteStreamOpen(file_name.c_str());
+      if (handle == k_UGCFileStreamHandleInvalid ||
+          !CompressCloudFile(file.content.data(), file.content.size(),
+                             kDefaultCloudCompressionLevel,
+                             [&](const char* data, size_t length) {
+                               return steam_remote_storage
+                                   ->FileWriteStreamWriteChunk(
+                                       handle, data,
+                                       static_cast<int32>(length));
+                             }) ||
+          !steam_remote_storage->FileWriteStreamClose(handle)) {
+        if (handle != k_UGCFileStreamHandleInvalid)
+          steam_remote_storage->FileWriteStreamCancel(handle);
+        result.error = "Error on writing file on Steam Cloud.";
+      }
+    } else if (!steam_remote_storage->FileWrite(
+                   file_name.c_str(), file.content.data(),
+                   static_cast<int32>(file.content.size()))) {
+      result.error = "Error on writing file on Steam Cloud.";
+    }
+    if (!result.error.empty())
+      ++failed_count;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      bytes_in_flight -= file.content.size();
+      queue_changed.notify_all();
+    }
+    progress.Send(&result, 1);
+  }
+  steam_remote_storage->EndFileWriteBatch();
+  reader.join();
+
+  if (failed_count > 0) {
+    SetErrorMessage(failed_count == files_path_.size()
+                        ? "Error on saving files to Steam Cloud."
+                        : "Error on saving some files to Steam Cloud.");
+  }
+}
+
+void FilesSaveWorker::HandleProgressCallback(const FileSaveProgress* data,
+                                             size_t count) {
+  if (!progress_callback_)
+    return;
+  Nan::HandleScope scope;
+  for (size_t i = 0; i < count; ++i) {
+    v8::Local<v8::Value> argv[] = {
+        Nan::New(files_path_[data[i].index]).ToLocalChecked(),
+        data[i].error.empty()
+            ? v8::Local<v8::Value>(Nan::Null())
+            : v8::Local<v8::Value>(Nan::New(data[i].error).ToLocalChecked())};
+    Nan::AsyncResource resource(
+        "greenworks:FilesSaveWorker.HandleProgressCallback");
+    progress_callback_->Call(2, argv, &resource);
+  }
+}
+
+FilesSyncWorker::FilesSyncWorker(Nan::Callback* success_callback,
+    Nan::Callback* error_callback, const std::vector<std::string>& files_path,
+    const std::string& manifest_path):
         SteamAsyncWorker(success_callback, error_callback),
-        files_path_(files_path) {
+        files_path_(files_path),
+        manifest_path_(manifest_path) {
 }
 
-void FilesSaveWorker::Execute() {
-  FilesContentContainer container;
-  std::vector<int> files_content_length;
+void FilesSyncWorker::Execute() {
+  SyncManifest manifest;
+  LoadSyncManifest(manifest_path_, &manifest);
+
+  // Only files whose size or modification time changed are hashed again.
+  std::vector<SyncManifestEntry> local(files_path_.size());
+  std::vector<std::string> names(files_path_.size());
+  std::vector<size_t> to_hash;
   for (size_t i = 0; i < files_path_.size(); ++i) {
-    char* content = nullptr;
-    int length = 0;
-    if (!utils::ReadFile(files_path_[i].c_str(), &content, &length))
-      break;
-    container.files_content.push_back(content);
-    files_content_length.push_back(length);
+    names[i] = utils::GetFileNameFromPath(files_path_[i]);
+    if (!utils::GetFileSizeAndTime(files_path_[i].c_str(), &local[i].size,
+                                   &local[i].mtime)) {
+      SetErrorMessage("Error on reading files.");
+      return;
+    }
+    auto it = manifest.find(names[i]);
+    if (it != manifest.end() && it->second.size == local[i].size &&
+        it->second.mtime == local[i].mtime) {
+      local[i].hash = it->second.hash;
+    } else {
+      to_hash.push_back(i);
+    }
   }
-  if (container.files_content.size() != files_path_.size()) {
+
+  std::atomic<size_t> next_index(0);
+  std::atomic<bool> hash_failed(false);
+  auto hash_files = [&] {
+    for (size_t i = next_index++; i < to_hash.size(); i = next_index++) {
+      size_t index = to_hash[i];
+      if (!utils::HashFile(files_path_[index].c_str(), &local[index].hash))
+        hash_failed = true;
+    }
+  };
+  size_t thread_count = std::min<size_t>(
+      std::max(1u, std::thread::hardware_concurrency()), to_hash.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_count; ++i)
+    threads.emplace_back(hash_files);
+  hash_files();
+  for (auto& thread : threads)
+    thread.join();
+  if (hash_failed) {
     SetErrorMessage("Error on reading files.");
     return;
   }
+
+  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+  steam_remote_storage->BeginFileWriteBatch();
   for (size_t i = 0; i < files_path_.size(); ++i) {
-    std::string file_name = utils::GetFileNameFromPath(files_path_[i]);
-    if (!SteamRemoteStorage()->FileWrite(file_name.c_str(),
-        container.files_content[i], files_content_length[i])) {
+    const char* name = names[i].c_str();
+    auto it = manifest.find(names[i]);
+    // Skip files whose content is unchanged and whose cloud copy is still the
+    // one uploaded last time.
+    if (it != manifest.end() && it->second.hash == local[i].hash &&
+        steam_remote_storage->FileExists(name) &&
+        steam_remote_storage->GetFileSize(name) == local[i].size &&
+        steam_remote_storage->GetFileTimestamp(name) ==
+            it->second.cloud_timestamp) {
+      it->second.mtime = local[i].mtime;
+      continue;
+    }
+
+    char* content = nullptr;
+    int length = 0;
+    if (!utils::ReadFile(files_path_[i].c_str(), &content, &length)) {
+      SetErrorMessage("Error on reading files.");
+      break;
+    }
+    bool is_written = steam_remote_storage->FileWrite(name, content, length);
+    delete[] content;
+    if (!is_written) {
       SetErrorMessage("Error on writing file on Steam Cloud.");
-      return;
+      break;
     }
+    local[i].size = length;
+    local[i].cloud_timestamp = steam_remote_storage->GetFileTimestamp(name);
+    manifest[names[i]] = local[i];
+    uploaded_files_.push_back(files_path_[i]);
   }
+  steam_remote_storage->EndFileWriteBatch();
+
+  // The manifest is saved even after an error, so the files uploaded so far
+  // aren't uploaded again.
+  if (!SaveSyncManifest(manifest_path_, manifest) && !ErrorMessage())
+    SetErrorMessage("Error on saving the sync manifest.");
 }
 
-FileDeleteWorker::FileDeleteWorker(Nan::Callback* success_callback,
-    Nan::Callback* error_callback, std::string file_name):
+void FilesSyncWorker::HandleOKCallback() {
+  Nan::HandleScope scope;
+  v8::Local<v8::Array> uploaded_files =
+      Nan::New<v8::Array>(static_cast<int>(uploaded_files_.size()));
+  for (size_t i = 0; i < uploaded_files_.size(); ++i) {
+    Nan::Set(uploaded_files, i,
+             Nan::New(uploaded_files_[i]).ToLocalChecked());
+  }
+  v8::Local<v8::Value> argv[] = { uploaded_files };
+  Nan::AsyncResource resource("greenworks:FilesSyncWorker.HandleOKCallback");
+  callback->Call(1, argv, &resource);
+}
+
+DeltaFileSaveWorker::DeltaFileSaveWorker(Nan::Callback* success_callback,
+    Nan::Callback* error_callback, const std::string& file_path,
+    uint32 block_size, double max_delta_ratio):
         SteamAsyncWorker(success_callback, error_callback),
-        file_name_(file_name) {
+        file_path_(file_path),
+        block_size_(block_size),
+        max_delta_ratio_(max_delta_ratio),
+        is_checkpoint_(false),
+        uploaded_bytes_(0) {
 }
 
-void FileDeleteWorker::Execute() {
-  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+void DeltaFileSaveWorker::Execute() {
+  char* content = nullptr;
+  int length = 0;
+  if (!utils::ReadFile(file_path_.c_str(), &content, &length)) {
+    SetErrorMessage("Error on reading file.");
+    return;
+  }
+  std::string file_content(content, length);
+  delete[] content;
 
-  if (!steam_remote_storage->FileExists(file_name_.c_str())) {
-    SetErrorMessage("File doesn't exist.");
+  std::string name = utils::GetFileNameFromPath(file_path_);
+  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+  // The signature only describes the checkpoint it was written with.
+  std::string signature_content;
+  DeltaSignature signature;
+  if (!ReadCloudFile(name + ".sig", &signature_content) ||
+      !ParseDeltaSignature(signature_content.data(), signature_content.size(),
+                           &signature) ||
+      !steam_remote_storage->FileExists(name.c_str()) ||
+      steam_remote_storage->GetFileSize(name.c_str()) !=
+          static_cast<int32>(signature.base_size) ||
+      steam_remote_storage->GetFileTimestamp(name.c_str()) !=
+          signature.base_timestamp) {
+    is_checkpoint_ = WriteCheckpoint(file_content);
     return;
   }
 
-  if (!steam_remote_storage->FileDelete(file_name_.c_str())) {
-    SetErrorMessage("Error on deleting file.");
+  std::string delta;
+  ComputeDelta(signature, file_content.data(), file_content.size(), &delta);
+  if (delta.size() > max_delta_ratio_ * file_content.size()) {
+    is_checkpoint_ = WriteCheckpoint(file_content);
     return;
   }
+  if (!steam_remote_storage->FileWrite((name + ".delta").c_str(), delta.data(),
+                                       static_cast<int32>(delta.size()))) {
+    SetErrorMessage("Error on writing file on Steam Cloud.");
+    return;
+  }
+  uploaded_bytes_ = delta.size();
 }
 
-FileReadWorker::FileReadWorker(Nan::Callback* success_callback,
-    Nan::Callback* error_callback, std::string file_name):
+bool DeltaFileSaveWorker::WriteCheckpoint(const std::string& content) {
+  std::string name = utils::GetFileNameFromPath(file_path_);
+  std::string delta_name = name + ".delta";
+  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+  steam_remote_storage->BeginFileWriteBatch();
+  // A delta left over from the previous checkpoint is ignored on read, so the
+  // order of these writes doesn't matter for consistency.
+  bool is_written = steam_remote_storage->FileWrite(
+      name.c_str(), content.data(), static_cast<int32>(content.size()));
+  if (is_written && steam_remote_storage->FileExists(delta_name.c_str()))
+    steam_remote_storage->FileDelete(delta_name.c_str());
+  std::string signature_content;
+  if (is_written) {
+    DeltaSignature signature;
+    ComputeDeltaSignature(content.data(), content.size(), block_size_,
+                          &signature);
+    signature.base_timestamp =
+        steam_remote_storage->GetFileTimestamp(name.c_str());
+    signature_content = SerializeDeltaSignature(signature);
+    is_written = steam_remote_storage->FileWrite(
+        (name + ".sig").c_str(), signature_content.data(),
+        static_cast<int32>(signature_content.size()));
+  }
+  steam_remote_storage->EndFileWriteBatch();
+  if (!is_written) {
+    SetErrorMessage("Error on writing file on Steam Cloud.");
+    return false;
+  }
+  uploaded_bytes_ = content.size() + signature_content.size();
+  return true;
+}
+
+void DeltaFileSaveWorker::HandleOKCallback() {
+  Nan::HandleScope scope;
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New("checkpoint").ToLocalChecked(),
+           Nan::New(is_checkpoint_));
+  Nan::Set(result, Nan::New("uploadedBytes").ToLocalChecked(),
+           Nan::New(static_cast<double>(uploaded_bytes_)));
+  v8::Local<v8::Value> argv[] = { result };
+  Nan::AsyncResource resource(
+      "greenworks:DeltaFileSaveWorker.HandleOKCallback");
+  callback->Call(1, argv, &resource);
+}
+
+DeltaFileReadWorker::DeltaFileReadWorker(Nan::Callback* success_callback,
+    Nan::Callback* error_callback, const std::string& file_name):
         SteamAsyncWorker(success_callback, error_callback),
         file_name_(file_name) {
 }
 
-void FileReadWorker::Execute() {
-  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
-
-  if (!steam_remote_storage->FileExists(file_name_.c_str())) {
+void DeltaFileReadWorker::Execute() {
+  std::string base;
+  if (!ReadCloudFile(file_name_, &base)) {
     SetErrorMessage("File doesn't exist.");
     return;
   }
+  std::string delta;
+  // Without a delta of this checkpoint, the checkpoint is the latest version.
+  if (!ReadCloudFile(file_name_ + ".delta", &delta) ||
+      !IsDeltaOfBase(delta.data(), delta.size(), base.data(), base.size())) {
+    content_.swap(base);
+    return;
+  }
+  if (!ApplyDelta(base.data(), base.size(), delta.data(), delta.size(),
+                  &content_)) {
+    SetErrorMessage("Error on applying file delta.");
+  }
+}
+
+void DeltaFileReadWorker::HandleOKCallback() {
+  Nan::HandleScope scope;
+  v8::Local<v8::Value> argv[] = {
+      Nan::CopyBuffer(content_.data(), static_cast<uint32_t>(content_.size()))
+          .ToLocalChecked() };
+  Nan::AsyncResource resource(
+      "greenworks:DeltaFileReadWorker.HandleOKCallback");
+  callback->Call(1, argv, &resource);
+}
 
-  int32 file_size = steam_remote_storage->GetFileSize(file_name_.c_str());
+FileWriteStreamOpenWorker::FileWriteStreamOpenWorker(
+    Nan::Callback* success_callback, Nan::Callback* error_callback,
+    const std::string& file_name):
+        SteamAsyncWorker(success_callback, error_callback),
+        file_name_(file_name),
+        handle_(k_UGCFileStreamHandleInvalid) {
+}
 
-  auto* content = new char[file_size+1];
-  int32 end_pos = steam_remote_storage->FileRead(
-      file_name_.c_str(), content, file_size);
-  content[end_pos] = '\0';
+void FileWriteStreamOpenWorker::Execute() {
+  handle_ = SteamRemoteStorage()->FileWriteStreamOpen(file_name_.c_str());
+  if (handle_ == k_UGCFileStreamHandleInvalid)
+    SetErrorMessage("Error on opening file for writing.");
+}
 
-  if (end_pos == 0 && file_size > 0) {
-    SetErrorMessage("Error on reading file.");
-  } else {
-    content_ = std::string(content);
+void FileWriteStreamOpenWorker::HandleOKCallback() {
+  Nan::HandleScope scope;
+  v8::Local<v8::Value> argv[] = {
+      Nan::New(utils::uint64ToString(handle_)).ToLocalChecked()};
+  Nan::AsyncResource resource(
+      "greenworks:FileWriteStreamOpenWorker.HandleOKCallback");
+  callback->Call(1, argv, &resource);
+}
+
+FileWriteStreamWriteWorker::FileWriteStreamWriteWorker(
+    Nan::Callback* success_callback, Nan::Callback* error_callback,
+    UGCFileWriteStreamHandle_t handle, const char* data, size_t length):
+        SteamAsyncWorker(success_callback, error_callback),
+        handle_(handle),
+        data_(data),
+        length_(length) {
+}
+
+void FileWriteStreamWriteWorker::Execute() {
+  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+  size_t offset = 0;
+  // Steam rejects chunks larger than k_unMaxCloudFileChunkSize.
+  while (offset < length_) {
+    size_t chunk_size = std::min<size_t>(length_ - offset,
+                                         k_unMaxCloudFileChunkSize);
+    if (!steam_remote_storage->FileWriteStreamWriteChunk(
+            handle_, data_ + offset, static_cast<int32>(chunk_size))) {
+      SetErrorMessage("Error on writing to file.");
+      return;
+    }
+    offset += chunk_size;
   }
+}
 
-  delete[] content;
+FileWriteStreamCloseWorker::FileWriteStreamCloseWorker(
+    Nan::Callback* success_callback, Nan::Callback* error_callback,
+    UGCFileWriteStreamHandle_t handle, bool cancel):
+        SteamAsyncWorker(success_callback, error_callback),
+        handle_(handle),
+        cancel_(cancel) {
+}
+
+void FileWriteStreamCloseWorker::Execute() {
+  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+  if (cancel_) {
+    if (!steam_remote_storage->FileWriteStreamCancel(handle_))
+      SetErrorMessage("Error on canceling file write.");
+    return;
+  }
+  if (!steam_remote_storage->FileWriteStreamClose(handle_))
+    SetErrorMessage("Error on writing file on Steam Cloud.");
+}
+
+FileDecompressWorker::FileDecompressWorker(Nan::Callback* success_callback,
+    Nan::Callback* error_callback, char* content, size_t content_size,
+    bool as_text):
+        SteamAsyncWorker(success_callback, error_callback),
+        content_(content),
+        content_size_(content_size),
+        as_text_(as_text),
+        output_(nullptr),
+        output_size_(0) {
 }
 
-void FileReadWorker::HandleOKCallback() {
+FileDecompressWorker::~FileDecompressWorker() {
+  free(content_);
+  free(output_);
+}
+
+void FileDecompressWorker::Execute() {
+  if (!ReadCloudCompressionHeader(content_, content_size_, &output_size_)) {
+    SetErrorMessage("Error on decompressing file.");
+    return;
+  }
+  if (as_text_ ? output_size_ > v8::String::kMaxLength
+               : !FitsInBuffer(output_size_)) {
+    SetErrorMessage("File is too large to decompress.");
+    return;
+  }
+  // Allocated with malloc, since the Buffer created from it frees it.
+  output_ = static_cast<char*>(malloc(std::max<uint64>(output_size_, 1)));
+  if (!output_ ||
+      !DecompressCloudFile(content_, content_size_, output_, output_size_)) {
+    SetErrorMessage("Error on decompressing file.");
+  }
+  free(content_);
+  content_ = nullptr;
+}
+
+void FileDecompressWorker::HandleOKCallback() {
   Nan::HandleScope scope;
 
-  v8::Local<v8::Value> argv[] = { Nan::New(content_).ToLocalChecked() };
-  Nan::AsyncResource resource("greenworks:FileReadWorker.HandleOKCallback");
+  v8::Local<v8::Value> argv[1];
+  if (as_text_) {
+    argv[0] = Nan::New(output_, static_cast<int>(strnlen(
+                                    output_, output_size_))).ToLocalChecked();
+  } else {
+    // The Buffer takes over |output_|.
+    argv[0] = Nan::NewBuffer(output_, static_cast<uint32_t>(output_size_))
+                  .ToLocalChecked();
+    output_ = nullptr;
+  }
+  Nan::AsyncResource resource(
+      "greenworks:FileDecompressWorker.HandleOKCallback");
   callback->Call(1, argv, &resource);
 }
 
+FileDeleteWorker::FileDeleteWorker(Nan::Callback* success_callback,
+    Nan::Callback* error_callback, std::string file_name):
+        SteamAsyncWorker(success_callback, error_callback),
+        file_name_(file_name) {
+}
+
+void FileDeleteWorker::Execute() {
+  ISteamRemoteStorage* steam_remote_storage = SteamRemoteStorage();
+
+  if (!steam_remote_storage->FileExists(file_name_.c_str())) {
+    SetErrorMessage("File doesn't exist.");
+    return;
+  }
+
+  if (!steam_remote_storage->FileDelete(file_name_.c_str())) {
+    SetErrorMessage("Error on deleting file.");
+    return;
+  }
+}
+
 CloudQuotaGetWorker::CloudQuotaGetWorker(Nan::Callback* success_callback,
       Nan::Callback* error_callback):SteamAsyncWorker(success_callback,
           error_callback), total_bytes_(-1), available_bytes_(-1) {
@@ -256,41 +789,258 @@ void GetNumberOfPlayersWorker::HandleOKCallback() {
 }
 
 CreateArchiveWorker::CreateArchiveWorker(Nan::Callback* success_callback,
-    Nan::Callback* error_callback, const std::string& zip_file_path,
-    const std::string& source_dir, const std::string& password,
-    int compress_level)
-        :SteamAsyncWorker(success_callback, error_callback),
-         zip_file_path_(zip_file_path),
-         source_dir_(source_dir),
-         password_(password),
-         compress_level_(compress_level) {
-}
-
-void CreateArchiveWorker::Execute() {
-  int result = zip(zip_file_path_.c_str(),
-                   source_dir_.c_str(),
-                   compress_level_,
-                   password_.empty()?nullptr:password_.c_str());
-  if (result)
+    Nan::Callback* error_callback, Nan::Callback* progress_callback,
+    const std::string& zip_file_path, const std::string& source_dir,
+    const std::string& password, const ZipOptions& options,
+    std::shared_ptr<std::atomic<bool>> cancel)
+        : SteamAsyncProgressWorker(success_callback, error_callback,
+                                   progress_callback),
+          zip_file_path_(zip_file_path),
+          source_dir_(source_dir),
+          password_(password),
+          options_(options),
+          cancel_(std::move(cancel)) {
+}
+
+void CreateArchiveWorker::Execute(const ExecutionProgress& progress) {
+  options_.password = password_.empty()?nullptr:password_.c_str();
+  options_.cancel = cancel_.get();
+  if (progress_callback_) {
+    options_.progress = [&progress](const ArchiveProgress& data) {
+      progress.Send(&data, 1);
+    };
+  }
+  int result = zip(zip_file_path_.c_str(), source_dir_.c_str(), options_);
+  if (result == kArchiveCancelled)
+    SetErrorMessage("Creating zip file was cancelled.");
+  else if (result)
     SetErrorMessage("Error on creating zip file.");
 }
 
+void CreateArchiveWorker::HandleProgressCallback(const ArchiveProgress* data,
+                                                 size_t count) {
+  CallArchiveProgressCallback(
+      progress_callback_, data, count,
+      "greenworks:CreateArchiveWorker.HandleProgressCallback");
+}
+
 ExtractArchiveWorker::ExtractArchiveWorker(Nan::Callback* success_callback,
+    Nan::Callback* error_callback, Nan::Callback* progress_callback,
+    const std::string& zip_file_path, const std::string& extract_path,
+    const std::string& password, int num_threads,
+    std::shared_ptr<std::atomic<bool>> cancel)
+        : SteamAsyncProgressWorker(success_callback, error_callback,
+                                   progress_callback),
+          zip_file_path_(zip_file_path),
+          extract_path_(extract_path),
+          password_(password),
+          num_threads_(num_threads),
+          cancel_(std::move(cancel)) {
+}
+
+void ExtractArchiveWorker::Execute(const ExecutionProgress& progress) {
+  UnzipOptions options;
+  options.password = password_.empty()?nullptr:password_.c_str();
+  options.num_threads = num_threads_;
+  options.cancel = cancel_.get();
+  if (progress_callback_) {
+    options.progress = [&progress](const ArchiveProgress& data) {
+      progress.Send(&data, 1);
+    };
+  }
+  int result = unzip(zip_file_path_.c_str(), extract_path_.c_str(), options);
+  if (result == kArchiveCancelled)
+    SetErrorMessage("Extracting zip file was cancelled.");
+  else if (result)
+    SetErrorMessage("Error on extracting zip file.");
+}
+
+void ExtractArchiveWorker::HandleProgressCallback(const ArchiveProgress* data,
+                                                  size_t count) {
+  CallArchiveProgressCallback(
+      progress_callback_, data, count,
+      "greenworks:ExtractArchiveWorker.HandleProgressCallback");
+}
+
+CreateArchiveToBufferWorker::CreateArchiveToBufferWorker(
+    Nan::Callback* success_callback, Nan::Callback* error_callback,
+    std::vector<ZipMemoryEntry> entries, const std::string& password,
+    const ZipOptions& options)
+        : SteamAsyncWorker(success_callback, error_callback),
+          entries_(std::move(entries)),
+          password_(password),
+          options_(options),
+          archive_(nullptr),
+          archive_size_(0) {
+}
+
+CreateArchiveToBufferWorker::~CreateArchiveToBufferWorker() {
+  free(archive_);
+}
+
+void CreateArchiveToBufferWorker::Execute() {
+  options_.password = password_.empty()?nullptr:password_.c_str();
+  if (zipToMemory(entries_, options_, &archive_, &archive_size_))
+    SetErrorMessage("Error on creating zip file.");
+  else if (!FitsInBuffer(archive_size_))
+    SetErrorMessage("Zip file is too large for a Buffer.");
+}
+
+void CreateArchiveToBufferWorker::HandleOKCallback() {
+  Nan::HandleScope scope;
+
+  // The Buffer takes over |archive_|.
+  v8::Local<v8::Value> argv[] = {
+      Nan::NewBuffer(archive_, static_cast<uint32_t>(archive_size_))
+          .ToLocalChecked() };
+  archive_ = nullptr;
+  Nan::AsyncResource resource(
+      "greenworks:CreateArchiveToBufferWorker.HandleOKCallback");
+  callback->Call(1, argv, &resource);
+}
+
+ExtractArchiveFromBufferWorker::ExtractArchiveFromBufferWorker(
+    Nan::Callback* success_callback, Nan::Callback* error_callback,
+    const char* archive, size_t archive_size, const std::string& password,
+    int num_threads)
+        : SteamAsyncWorker(success_callback, error_callback),
+          archive_(archive),
+          archive_size_(archive_size),
+          password_(password),
+          num_threads_(num_threads) {
+}
+
+ExtractArchiveFromBufferWorker::~ExtractArchiveFromBufferWorker() {
+  for (UnzippedEntry& entry : entries_)
+    free(entry.data);
+}
+
+void ExtractArchiveFromBufferWorker::Execute() {
+  UnzipOptions options;
+  options.password = password_.empty()?nullptr:password_.c_str();
+  options.num_threads = num_threads_;
+  if (unzipFromMemory(archive_, archive_size_, options, &entries_)) {
+    SetErrorMessage("Error on extracting zip file.");
+    return;
+  }
+  for (const UnzippedEntry& entry : entries_) {
+    if (!FitsInBuffer(entry.size)) {
+      SetErrorMessage("Zip entry is too large for a Buffer.");
+      return;
+    }
+  }
+}
+
+void ExtractArchiveFromBufferWorker::HandleOKCallback() {
+  Nan::HandleScope scope;
+
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  for (UnzippedEntry& entry : entries_) {
+    // The Buffer takes over the entry's data.
+    Nan::Set(result, Nan::New(entry.name).ToLocalChecked(),
+             Nan::NewBuffer(entry.data, static_cast<uint32_t>(entry.size))
+                 .ToLocalChecked());
+    entry.data = nullptr;
+  }
+  v8::Local<v8::Value> argv[] = { result };
+  Nan::AsyncResource resource(
+      "greenworks:ExtractArchiveFromBufferWorker.HandleOKCallback");
+  callback->Call(1, argv, &resource);
+}
+
+ListArchiveWorker::ListArchiveWorker(Nan::Callback* success_callback,
+    Nan::Callback* error_callback, const std::string& zip_file_path)
+        : SteamAsyncWorker(success_callback, error_callback),
+          zip_file_path_(zip_file_path) {
+}
+
+void ListArchiveWorker::Execute() {
+  if (listArchive(zip_file_path_.c_str(), &listing_))
+    SetErrorMessage("Error on reading zip file.");
+}
+
+void ListArchiveWorker::HandleOKCallback() {
+  Nan::HandleScope scope;
+
+  v8::Local<v8::Array> names = Nan::New<v8::Array>(
+      static_cast<int>(listing_.names.size()));
+  for (size_t i = 0; i < listing_.names.size(); ++i)
+    Nan::Set(names, static_cast<uint32_t>(i),
+             Nan::New(listing_.names[i]).ToLocalChecked());
+  v8::Local<v8::Object> result = Nan::New<v8::Object>();
+  Nan::Set(result, Nan::New("names").ToLocalChecked(), names);
+  Nan::Set(result, Nan::New("sizes").ToLocalChecked(),
+           NewTypedArray<v8::Float64Array, double>(listing_.sizes));
+  Nan::Set(result, Nan::New("compressedSizes").ToLocalChecked(),
+           NewTypedArray<v8::Float64Array, double>(listing_.compressed_sizes));
+  Nan::Set(result, Nan::New("crcs").ToLocalChecked(),
+           NewTypedArray<v8::Uint32Array, uint32_t>(listing_.crcs));
+  Nan::Set(result, Nan::New("mtimes").ToLocalChecked(),
+           NewTypedArray<v8::Float64Array, double>(listing_.mtimes));
+  v8::Local<v8::Value> argv[] = { result };
+  Nan::AsyncResource resource("greenworks:ListArchiveWorker.HandleOKCallback");
+  callback->Call(1, argv, &resource);
+}
+
+ExtractEntriesWorker::ExtractEntriesWorker(Nan::Callback* success_callback,
     Nan::Callback* error_callback, const std::string& zip_file_path,
-    const std::string& extract_path, const std::string& password)
+    const std::vector<std::string>& names, bool glob,
+    const std::string& extract_path, const std::string& password,
+    int num_threads)
         : SteamAsyncWorker(success_callback, error_callback),
           zip_file_path_(zip_file_path),
+          names_(names),
+          glob_(glob),
           extract_path_(extract_path),
-          password_(password) {
+          password_(password),
+          num_threads_(num_threads) {
 }
 
-void ExtractArchiveWorker::Execute() {
-  int result = unzip(zip_file_path_.c_str(), extract_path_.c_str(),
-      password_.empty()?nullptr:password_.c_str());
+void ExtractEntriesWorker::Execute() {
+  UnzipOptions options;
+  options.password = password_.empty()?nullptr:password_.c_str();
+  options.num_threads = num_threads_;
+  int result = unzipEntries(zip_file_path_.c_str(), extract_path_.c_str(),
+                            names_, glob_, options);
   if (result)
     SetErrorMessage("Error on extracting zip file.");
 }
 
+ReadEntryWorker::ReadEntryWorker(Nan::Callback* success_callback,
+    Nan::Callback* error_callback, const std::string& zip_file_path,
+    const std::string& name, const std::string& password)
+        : SteamAsyncWorker(success_callback, error_callback),
+          zip_file_path_(zip_file_path),
+          name_(name),
+          password_(password),
+          content_(nullptr),
+          content_size_(0) {
+}
+
+ReadEntryWorker::~ReadEntryWorker() {
+  free(content_);
+}
+
+void ReadEntryWorker::Execute() {
+  if (readEntry(zip_file_path_.c_str(), name_.c_str(), password_.c_str(),
+                &content_, &content_size_))
+    SetErrorMessage("Error on reading zip entry.");
+  else if (!FitsInBuffer(content_size_))
+    SetErrorMessage("Zip entry is too large for a Buffer.");
+}
+
+void ReadEntryWorker::HandleOKCallback() {
+  Nan::HandleScope scope;
+
+  // The Buffer takes over |content_|.
+  v8::Local<v8::Value> argv[] = {
+      Nan::NewBuffer(content_, static_cast<uint32_t>(content_size_))
+          .ToLocalChecked() };
+  content_ = nullptr;
+  Nan::AsyncResource resource("greenworks:ReadEntryWorker.HandleOKCallback");
+  callback->Call(1, argv, &resource);
+}
+
 GetAuthSessionTicketWorker::GetAuthSessionTicketWorker(
   Nan::Callback* success_callback,
   Nan::Callback* error_callback )
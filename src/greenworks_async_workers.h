@@ -5,13 +5,17 @@
 #ifndef SRC_GREENWORKS_ASYNC_WORKERS_H_
 #define SRC_GREENWORKS_ASYNC_WORKERS_H_
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "steam/steam_api.h"
 
 #include "steam_async_worker.h"
+#include "greenworks_unzip.h"
 #include "greenworks_utils.h"
+#include "greenworks_zip.h"
 #include "greenworks_workshop_workers.h"
 
 namespace greenworks {
@@ -21,31 +25,96 @@ class FileContentSaveWorker : public SteamAsyncWorker {
   FileContentSaveWorker(Nan::Callback* success_callback,
                         Nan::Callback* error_callback,
                         std::string file_name,
-                        std::string content);
+                        std::string content,
+                        bool compress = false);
 
   void Execute() override;
 
  private:
   std::string file_name_;
   std::string content_;
+  bool compress_;
 };
 
-class FilesSaveWorker : public SteamAsyncWorker {
+// The result of saving one file of a FilesSaveWorker.
+struct FileSaveProgress {
+  size_t index;
+  std::string error;
+};
+
+// Saves local files to Steam Cloud. The next files are read from disk while
+// the current one is being written, keeping at most |max_bytes_in_flight|
+// bytes of file content in memory (or a single file, if it's larger).
+class FilesSaveWorker : public SteamAsyncProgressWorker<FileSaveProgress> {
  public:
   FilesSaveWorker(Nan::Callback* success_callback,
                   Nan::Callback* error_callback,
-                  const std::vector<std::string>& files_path);
+                  Nan::Callback* progress_callback,
+                  const std::vector<std::string>& files_path,
+                  size_t max_bytes_in_flight,
+                  bool compress);
+
+  void Execute(const ExecutionProgress& progress) override;
+  void HandleProgressCallback(const FileSaveProgress* data,
+                              size_t count) override;
+
+ private:
+  std::vector<std::string> files_path_;
+  size_t max_bytes_in_flight_;
+  bool compress_;
+};
+
+// Saves the local files which changed since the last sync to Steam Cloud. A
+// manifest of each file's size, modification time, content hash and cloud
+// timestamp is kept at |manifest_path|, so unchanged files are neither hashed
+// nor uploaded again.
+class FilesSyncWorker : public SteamAsyncWorker {
+ public:
+  FilesSyncWorker(Nan::Callback* success_callback,
+                  Nan::Callback* error_callback,
+                  const std::vector<std::string>& files_path,
+                  const std::string& manifest_path);
 
   void Execute() override;
+  void HandleOKCallback() override;
 
  private:
   std::vector<std::string> files_path_;
+  std::string manifest_path_;
+  std::vector<std::string> uploaded_files_;
 };
 
-class FileReadWorker : public SteamAsyncWorker {
+// Saves a local file to Steam Cloud as a delta against the last checkpoint of
+// it. The cloud keeps the checkpoint as |name|, its signature as |name|.sig
+// and the latest delta as |name|.delta. A new checkpoint is written instead
+// once the delta exceeds |max_delta_ratio| of the file's size.
+class DeltaFileSaveWorker : public SteamAsyncWorker {
  public:
-  FileReadWorker(Nan::Callback* success_callback, Nan::Callback* error_callback,
-      std::string file_name);
+  DeltaFileSaveWorker(Nan::Callback* success_callback,
+                      Nan::Callback* error_callback,
+                      const std::string& file_path,
+                      uint32 block_size,
+                      double max_delta_ratio);
+
+  void Execute() override;
+  void HandleOKCallback() override;
+
+ private:
+  bool WriteCheckpoint(const std::string& content);
+
+  std::string file_path_;
+  uint32 block_size_;
+  double max_delta_ratio_;
+  bool is_checkpoint_;
+  size_t uploaded_bytes_;
+};
+
+// Reads the latest version of a file saved by DeltaFileSaveWorker.
+class DeltaFileReadWorker : public SteamAsyncWorker {
+ public:
+  DeltaFileReadWorker(Nan::Callback* success_callback,
+                      Nan::Callback* error_callback,
+                      const std::string& file_name);
 
   void Execute() override;
   void HandleOKCallback() override;
@@ -55,6 +124,75 @@ class FileReadWorker : public SteamAsyncWorker {
   std::string content_;
 };
 
+class FileWriteStreamOpenWorker : public SteamAsyncWorker {
+ public:
+  FileWriteStreamOpenWorker(Nan::Callback* success_callback,
+                            Nan::Callback* error_callback,
+                            const std::string& file_name);
+
+  void Execute() override;
+  void HandleOKCallback() override;
+
+ private:
+  std::string file_name_;
+  UGCFileWriteStreamHandle_t handle_;
+};
+
+// Writes |length| bytes of |data| to an open cloud file write stream. |data|
+// isn't copied, the caller keeps it alive until the worker completes.
+class FileWriteStreamWriteWorker : public SteamAsyncWorker {
+ public:
+  FileWriteStreamWriteWorker(Nan::Callback* success_callback,
+                             Nan::Callback* error_callback,
+                             UGCFileWriteStreamHandle_t handle,
+                             const char* data,
+                             size_t length);
+
+  void Execute() override;
+
+ private:
+  UGCFileWriteStreamHandle_t handle_;
+  const char* data_;
+  size_t length_;
+};
+
+// Commits (or discards, if |cancel|) the file of a cloud file write stream.
+class FileWriteStreamCloseWorker : public SteamAsyncWorker {
+ public:
+  FileWriteStreamCloseWorker(Nan::Callback* success_callback,
+                             Nan::Callback* error_callback,
+                             UGCFileWriteStreamHandle_t handle,
+                             bool cancel);
+
+  void Execute() override;
+
+ private:
+  UGCFileWriteStreamHandle_t handle_;
+  bool cancel_;
+};
+
+// Decompresses a compressed cloud file read into |content|, which must be
+// allocated with malloc and is owned by the worker.
+class FileDecompressWorker : public SteamAsyncWorker {
+ public:
+  FileDecompressWorker(Nan::Callback* success_callback,
+                       Nan::Callback* error_callback,
+                       char* content,
+                       size_t content_size,
+                       bool as_text);
+  ~FileDecompressWorker() override;
+
+  void Execute() override;
+  void HandleOKCallback() override;
+
+ private:
+  char* content_;
+  size_t content_size_;
+  bool as_text_;
+  char* output_;
+  uint64 output_size_;
+};
+
 class FileDeleteWorker : public SteamAsyncWorker {
  public:
   FileDeleteWorker(Nan::Callback* success_callback,
@@ -132,38 +270,157 @@ class GetNumberOfPlayersWorker : public SteamCallbackAsyncWorker {
   CCallResult<GetNumberOfPlayersWorker, NumberOfCurrentPlayers_t> call_result_;
 };
 
-class CreateArchiveWorker : public SteamAsyncWorker {
+class CreateArchiveWorker : public SteamAsyncProgressWorker<ArchiveProgress> {
  public:
   CreateArchiveWorker(Nan::Callback* success_callback,
                       Nan::Callback* error_callback,
+                      Nan::Callback* progress_callback,
                       const std::string& zip_file_path,
                       const std::string& source_dir,
                       const std::string& password,
-                      int compress_level);
+                      const ZipOptions& options,
+                      std::shared_ptr<std::atomic<bool>> cancel);
 
-  void Execute() override;
+  void Execute(const ExecutionProgress& progress) override;
+  void HandleProgressCallback(const ArchiveProgress* data,
+                              size_t count) override;
 
  private:
   std::string zip_file_path_;
   std::string source_dir_;
   std::string password_;
-  int compress_level_;
+  // |options_.password| is set from |password_| on execution.
+  ZipOptions options_;
+  std::shared_ptr<std::atomic<bool>> cancel_;
 };
 
-class ExtractArchiveWorker : public SteamAsyncWorker {
+class ExtractArchiveWorker : public SteamAsyncProgressWorker<ArchiveProgress> {
  public:
   ExtractArchiveWorker(Nan::Callback* success_callback,
+                       Nan::Callback* error_callback,
+                       Nan::Callback* progress_callback,
+                       const std::string& zip_file_path,
+                       const std::string& extract_path,
+                       const std::string& password,
+                       int num_threads,
+                       std::shared_ptr<std::atomic<bool>> cancel);
+
+  void Execute(const ExecutionProgress& progress) override;
+  void HandleProgressCallback(const ArchiveProgress* data,
+                              size_t count) override;
+
+ private:
+  std::string zip_file_path_;
+  std::string extract_path_;
+  std::string password_;
+  int num_threads_;
+  std::shared_ptr<std::atomic<bool>> cancel_;
+};
+
+// Archives in-memory entries into a zip Buffer. The entries' data must stay
+// alive until the worker completes.
+class CreateArchiveToBufferWorker : public SteamAsyncWorker {
+ public:
+  CreateArchiveToBufferWorker(Nan::Callback* success_callback,
+                              Nan::Callback* error_callback,
+                              std::vector<ZipMemoryEntry> entries,
+                              const std::string& password,
+                              const ZipOptions& options);
+  ~CreateArchiveToBufferWorker() override;
+
+  void Execute() override;
+  void HandleOKCallback() override;
+
+ private:
+  std::vector<ZipMemoryEntry> entries_;
+  std::string password_;
+  // |options_.password| is set from |password_| on execution.
+  ZipOptions options_;
+  char* archive_;
+  size_t archive_size_;
+};
+
+// Extracts a zip archive held in memory, passing an object of file names to
+// Buffers.
+class ExtractArchiveFromBufferWorker : public SteamAsyncWorker {
+ public:
+  ExtractArchiveFromBufferWorker(Nan::Callback* success_callback,
+                                 Nan::Callback* error_callback,
+                                 const char* archive,
+                                 size_t archive_size,
+                                 const std::string& password,
+                                 int num_threads);
+  ~ExtractArchiveFromBufferWorker() override;
+
+  void Execute() override;
+  void HandleOKCallback() override;
+
+ private:
+  const char* archive_;
+  size_t archive_size_;
+  std::string password_;
+  int num_threads_;
+  std::vector<UnzippedEntry> entries_;
+};
+
+// Lists an archive's entries as columns of names, sizes, compressed sizes,
+// CRCs and mtimes.
+class ListArchiveWorker : public SteamAsyncWorker {
+ public:
+  ListArchiveWorker(Nan::Callback* success_callback,
+                    Nan::Callback* error_callback,
+                    const std::string& zip_file_path);
+
+  void Execute() override;
+  void HandleOKCallback() override;
+
+ private:
+  std::string zip_file_path_;
+  ArchiveListing listing_;
+};
+
+// Extracts the entries with the given names, or matching the given globs.
+class ExtractEntriesWorker : public SteamAsyncWorker {
+ public:
+  ExtractEntriesWorker(Nan::Callback* success_callback,
                        Nan::Callback* error_callback,
                        const std::string& zip_file_path,
+                       const std::vector<std::string>& names,
+                       bool glob,
                        const std::string& extract_path,
-                       const std::string& password);
+                       const std::string& password,
+                       int num_threads);
 
   void Execute() override;
 
  private:
   std::string zip_file_path_;
+  std::vector<std::string> names_;
+  bool glob_;
   std::string extract_path_;
   std::string password_;
+  int num_threads_;
+};
+
+// Reads a single archive entry into a Buffer.
+class ReadEntryWorker : public SteamAsyncWorker {
+ public:
+  ReadEntryWorker(Nan::Callback* success_callback,
+                  Nan::Callback* error_callback,
+                  const std::string& zip_file_path,
+                  const std::string& name,
+                  const std::string& password);
+  ~ReadEntryWorker() override;
+
+  void Execute() override;
+  void HandleOKCallback() override;
+
+ private:
+  std::string zip_file_path_;
+  std::string name_;
+  std::string password_;
+  char* content_;
+  size_t content_size_;
 };
 
 class GetAuthSessionTicketWorker : public SteamCallbackAsyncWorker {
@@ -0,0 +1,138 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "greenworks_cloud_compression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "zlib/zlib.h"
+
+namespace greenworks {
+
+namespace {
+
+const char kMagic[] = {'\0', 'G', 'W', 'Z'};
+const uint8 kVersion = 1;
+const uint8 kMethodDeflate = Z_DEFLATED;
+
+// The size of the compressed chunks passed to the writer.
+const size_t kChunkSize = 256 * 1024;
+
+// zlib takes at most a uInt of input at a time.
+const size_t kMaxInputSize = 1 << 30;
+
+// deflate can't compress better than about 1032:1, so a header claiming
+// more than that is corrupt.
+const uint64 kMaxDeflateRatio = 1032;
+
+}  // namespace
+
+bool CompressCloudFile(const char* data, size_t length, int level,
+                       const CompressedChunkWriter& writer) {
+  char header[kCloudCompressionHeaderSize] = {0};
+  memcpy(header, kMagic, sizeof(kMagic));
+  header[4] = static_cast<char>(kVersion);
+  header[5] = static_cast<char>(kMethodDeflate);
+  uint64 original_size = length;
+  for (int i = 0; i < 8; ++i)
+    header[8 + i] = static_cast<char>((original_size >> (8 * i)) & 0xff);
+  if (!writer(header, sizeof(header)))
+    return false;
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit(&stream, level) != Z_OK)
+    return false;
+
+  std::string chunk(kChunkSize, '\0');
+  size_t offset = 0;
+  int result = Z_OK;
+  do {
+    if (stream.avail_in == 0 && offset < length) {
+      size_t input_size = std::min(length - offset, kMaxInputSize);
+      stream.next_in =
+          reinterpret_cast<Bytef*>(const_cast<char*>(data + offset));
+      stream.avail_in = static_cast<uInt>(input_size);
+      offset += input_size;
+    }
+    stream.next_out = reinterpret_cast<Bytef*>(&chunk[0]);
+    stream.avail_out = static_cast<uInt>(chunk.size());
+    result = deflate(&stream, offset == length ? Z_FINISH : Z_NO_FLUSH);
+    if (result == Z_STREAM_ERROR)
+      break;
+    size_t output_size = chunk.size() - stream.avail_out;
+    if (output_size > 0 && !writer(chunk.data(), output_size)) {
+      result = Z_STREAM_ERROR;
+      break;
+    }
+  } while (result != Z_STREAM_END);
+  deflateEnd(&stream);
+  return result == Z_STREAM_END;
+}
+
+bool IsCompressedCloudFile(const char* data, size_t length) {
+  return length >= sizeof(kMagic) && memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool ReadCloudCompressionHeader(const char* data, size_t length,
+                                uint64* original_size) {
+  if (length < kCloudCompressionHeaderSize ||
+      !IsCompressedCloudFile(data, length) ||
+      static_cast<uint8>(data[4]) != kVersion ||
+      static_cast<uint8>(data[5]) != kMethodDeflate) {
+    return false;
+  }
+  *original_size = 0;
+  for (int i = 0; i < 8; ++i)
+    *original_size |= static_cast<uint64>(static_cast<uint8>(data[8 + i]))
+                      << (8 * i);
+  uint64 compressed_size = length - kCloudCompressionHeaderSize;
+  return *original_size / kMaxDeflateRatio <= compressed_size;
+}
+
+bool DecompressCloudFile(const char* data, size_t length, char* output,
+                         uint64 output_size) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit(&stream) != Z_OK)
+    return false;
+
+  const char* input = data + kCloudCompressionHeaderSize;
+  size_t input_size = length - kCloudCompressionHeaderSize;
+  size_t input_offset = 0;
+  uint64 output_offset = 0;
+  // Empty content still needs room for inflate to make progress.
+  char empty_output;
+  if (output_size == 0) {
+    stream.next_out = reinterpret_cast<Bytef*>(&empty_output);
+    stream.avail_out = 1;
+  }
+  int result = Z_OK;
+  do {
+    if (stream.avail_in == 0 && input_offset < input_size) {
+      size_t size = std::min(input_size - input_offset, kMaxInputSize);
+      stream.next_in =
+          reinterpret_cast<Bytef*>(const_cast<char*>(input + input_offset));
+      stream.avail_in = static_cast<uInt>(size);
+      input_offset += size;
+    }
+    if (stream.avail_out == 0 && output_offset < output_size) {
+      size_t size = static_cast<size_t>(
+          std::min<uint64>(output_size - output_offset, kMaxInputSize));
+      stream.next_out = reinterpret_cast<Bytef*>(output + output_offset);
+      stream.avail_out = static_cast<uInt>(size);
+      output_offset += size;
+    }
+    result = inflate(&stream, Z_NO_FLUSH);
+  } while (result == Z_OK);
+  // The content must fill the output exactly.
+  bool is_complete = result == Z_STREAM_END && output_offset == output_size &&
+                     stream.avail_out == (output_size == 0 ? 1u : 0u);
+  inflateEnd(&stream);
+  return is_complete;
+}
+
+}  // namespace greenworks
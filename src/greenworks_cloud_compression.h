@@ -0,0 +1,52 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#ifndef SRC_GREENWORKS_CLOUD_COMPRESSION_H_
+#define SRC_GREENWORKS_CLOUD_COMPRESSION_H_
+
+#include <cstddef>
+#include <functional>
+
+#include "steam/steamtypes.h"
+
+namespace greenworks {
+
+// Compressed cloud files start with a header describing them, followed by the
+// zlib stream of the original content:
+//   "\0GWZ" | version (1 byte) | method (1 byte, 8 = deflate) |
+//   reserved (2 bytes) | original size (8 bytes, little-endian)
+// Text saves never start with a NUL byte, so they can't be mistaken for one.
+const size_t kCloudCompressionHeaderSize = 16;
+
+// The zlib level cloud saves are compressed with.
+const int kDefaultCloudCompressionLevel = 6;
+
+// Receives the compressed output chunk by chunk. Returns false to abort.
+typedef std::function<bool(const char* data, size_t length)>
+    CompressedChunkWriter;
+
+// Compresses |length| bytes of |data| at zlib |level|, passing the header
+// and compressed content to |writer| in chunks of bounded size.
+bool CompressCloudFile(const char* data, size_t length, int level,
+                       const CompressedChunkWriter& writer);
+
+// Returns whether |data| starts like a compressed cloud file. Its header is
+// only checked by ReadCloudCompressionHeader.
+bool IsCompressedCloudFile(const char* data, size_t length);
+
+// Reads the header of the compressed cloud file in |data| into
+// |original_size|. Returns false if the header is truncated, of an unknown
+// version or method, or claims more original content than |length| bytes
+// can inflate to.
+bool ReadCloudCompressionHeader(const char* data, size_t length,
+                                uint64* original_size);
+
+// Decompresses the compressed cloud file in |data| into |output|, which must
+// hold exactly the original size read by ReadCloudCompressionHeader.
+bool DecompressCloudFile(const char* data, size_t length, char* output,
+                         uint64 output_size);
+
+}  // namespace greenworks
+
+#endif  // SRC_GREENWORKS_CLOUD_COMPRESSION_H_
@@ -0,0 +1,296 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "greenworks_cloud_delta.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "greenworks_utils.h"
+
+namespace greenworks {
+
+namespace {
+
+const char kSignatureMagic[] = {'\0', 'G', 'W', 'S'};
+const char kDeltaMagic[] = {'\0', 'G', 'W', 'D'};
+const uint8 kVersion = 1;
+
+// magic | version | reserved (3 bytes) | block size (4) | base size (8) |
+// base hash (8) | base timestamp (8) | block count (8)
+const size_t kSignatureHeaderSize = 44;
+// magic | version | reserved (3 bytes) | base size (8) | base hash (8) |
+// result size (8) | result hash (8) | block size (4)
+const size_t kDeltaHeaderSize = 44;
+
+// The delta operations, each followed by varint operands.
+const char kCopyBlocks = 'C';   // first block, block count
+const char kLiteral = 'L';      // length, then the bytes
+
+void AppendUint(std::string* out, uint64 value, int bytes) {
+  for (int i = 0; i < bytes; ++i)
+    out->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+uint64 ReadUint(const char* data, int bytes) {
+  uint64 value = 0;
+  for (int i = 0; i < bytes; ++i)
+    value |= static_cast<uint64>(static_cast<uint8>(data[i])) << (8 * i);
+  return value;
+}
+
+void AppendVarint(std::string* out, uint64 value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool ReadVarint(const char** data, const char* end, uint64* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && *data < end; shift += 7) {
+    uint8 byte = static_cast<uint8>(*(*data)++);
+    *value |= static_cast<uint64>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+// The rsync rolling checksum: |a| is the sum of the bytes and |b| the sum of
+// the running sums, each kept to 16 bits.
+class RollingChecksum {
+ public:
+  RollingChecksum(const char* data, size_t length) : a_(0), b_(0),
+      length_(static_cast<uint32>(length)) {
+    for (size_t i = 0; i < length; ++i) {
+      a_ += static_cast<uint8>(data[i]);
+      b_ += a_;
+    }
+  }
+
+  // Slides the window one byte, dropping |out| and adding |in|.
+  void Roll(uint8 out, uint8 in) {
+    a_ += in - out;
+    b_ += a_ - length_ * out;
+  }
+
+  uint32 value() const { return (a_ & 0xffff) | (b_ << 16); }
+
+ private:
+  uint32 a_;
+  uint32 b_;
+  uint32 length_;
+};
+
+void AppendLiteral(const char* data, size_t length, std::string* delta) {
+  if (length == 0)
+    return;
+  delta->push_back(kLiteral);
+  AppendVarint(delta, length);
+  delta->append(data, length);
+}
+
+bool ParseDeltaHeader(const char* delta, size_t delta_length,
+                      uint64* base_size, uint64* base_hash) {
+  if (delta_length < kDeltaHeaderSize ||
+      memcmp(delta, kDeltaMagic, sizeof(kDeltaMagic)) != 0 ||
+      static_cast<uint8>(delta[4]) != kVersion) {
+    return false;
+  }
+  *base_size = ReadUint(delta + 8, 8);
+  *base_hash = ReadUint(delta + 16, 8);
+  return true;
+}
+
+}  // namespace
+
+void ComputeDeltaSignature(const char* data, size_t length, uint32 block_size,
+                           DeltaSignature* signature) {
+  signature->block_size = block_size;
+  signature->base_size = length;
+  signature->base_hash = utils::HashContent(data, length, 0);
+  size_t block_count = length / block_size;
+  signature->weak_checksums.resize(block_count);
+  signature->strong_checksums.resize(block_count);
+  for (size_t i = 0; i < block_count; ++i) {
+    const char* block = data + i * block_size;
+    signature->weak_checksums[i] = RollingChecksum(block, block_size).value();
+    signature->strong_checksums[i] =
+        utils::HashContent(block, block_size, 0);
+  }
+}
+
+std::string SerializeDeltaSignature(const DeltaSignature& signature) {
+  std::string out(kSignatureMagic, sizeof(kSignatureMagic));
+  out.push_back(static_cast<char>(kVersion));
+  out.append(3, '\0');
+  AppendUint(&out, signature.block_size, 4);
+  AppendUint(&out, signature.base_size, 8);
+  AppendUint(&out, signature.base_hash, 8);
+  AppendUint(&out, static_cast<uint64>(signature.base_timestamp), 8);
+  AppendUint(&out, signature.weak_checksums.size(), 8);
+  out.reserve(out.size() + signature.weak_checksums.size() * 12);
+  for (size_t i = 0; i < signature.weak_checksums.size(); ++i) {
+    AppendUint(&out, signature.weak_checksums[i], 4);
+    AppendUint(&out, signature.strong_checksums[i], 8);
+  }
+  return out;
+}
+
+bool ParseDeltaSignature(const char* data, size_t length,
+                         DeltaSignature* signature) {
+  if (length < kSignatureHeaderSize ||
+      memcmp(data, kSignatureMagic, sizeof(kSignatureMagic)) != 0 ||
+      static_cast<uint8>(data[4]) != kVersion) {
+    return false;
+  }
+  signature->block_size = static_cast<uint32>(ReadUint(data + 8, 4));
+  signature->base_size = ReadUint(data + 12, 8);
+  signature->base_hash = ReadUint(data + 20, 8);
+  signature->base_timestamp = static_cast<int64>(ReadUint(data + 28, 8));
+  uint64 block_count = ReadUint(data + 36, 8);
+  if (signature->block_size == 0 ||
+      block_count != (length - kSignatureHeaderSize) / 12 ||
+      block_count != signature->base_size / signature->block_size) {
+    return false;
+  }
+  signature->weak_checksums.resize(block_count);
+  signature->strong_checksums.resize(block_count);
+  const char* entry = data + kSignatureHeaderSize;
+  for (uint64 i = 0; i < block_count; ++i, entry += 12) {
+    signature->weak_checksums[i] = static_cast<uint32>(ReadUint(entry, 4));
+    signature->strong_checksums[i] = ReadUint(entry + 4, 8);
+  }
+  return true;
+}
+
+void ComputeDelta(const DeltaSignature& signature, const char* data,
+                  size_t length, std::string* delta) {
+  delta->assign(kDeltaMagic, sizeof(kDeltaMagic));
+  delta->push_back(static_cast<char>(kVersion));
+  delta->append(3, '\0');
+  AppendUint(delta, signature.base_size, 8);
+  AppendUint(delta, signature.base_hash, 8);
+  AppendUint(delta, length, 8);
+  AppendUint(delta, utils::HashContent(data, length, 0), 8);
+  AppendUint(delta, signature.block_size, 4);
+
+  // Maps each weak checksum to the first block having it.
+  std::unordered_map<uint32, size_t> blocks;
+  blocks.reserve(signature.weak_checksums.size());
+  for (size_t i = 0; i < signature.weak_checksums.size(); ++i)
+    blocks.emplace(signature.weak_checksums[i], i);
+
+  const size_t block_size = signature.block_size;
+  size_t literal_start = 0;
+  size_t offset = 0;
+  // The run of consecutive base blocks being copied.
+  size_t copy_start = 0;
+  size_t copy_count = 0;
+  auto flush_copy = [&] {
+    if (copy_count == 0)
+      return;
+    delta->push_back(kCopyBlocks);
+    AppendVarint(delta, copy_start);
+    AppendVarint(delta, copy_count);
+    copy_count = 0;
+  };
+
+  if (length >= block_size && !blocks.empty()) {
+    RollingChecksum checksum(data, block_size);
+    while (true) {
+      auto it = blocks.find(checksum.value());
+      // Weak matches are confirmed with the strong checksum, which is only
+      // computed for them.
+      if (it != blocks.end() &&
+          utils::HashContent(data + offset, block_size, 0) ==
+              signature.strong_checksums[it->second]) {
+        if (literal_start < offset) {
+          flush_copy();
+          AppendLiteral(data + literal_start, offset - literal_start, delta);
+        }
+        if (copy_count > 0 && copy_start + copy_count == it->second) {
+          ++copy_count;
+        } else {
+          flush_copy();
+          copy_start = it->second;
+          copy_count = 1;
+        }
+        offset += block_size;
+        literal_start = offset;
+        if (offset + block_size > length)
+          break;
+        checksum = RollingChecksum(data + offset, block_size);
+        continue;
+      }
+      if (offset + block_size >= length)
+        break;
+      checksum.Roll(static_cast<uint8>(data[offset]),
+                    static_cast<uint8>(data[offset + block_size]));
+      ++offset;
+    }
+  }
+  flush_copy();
+  AppendLiteral(data + literal_start, length - literal_start, delta);
+}
+
+bool IsDeltaOfBase(const char* delta, size_t delta_length, const char* base,
+                   size_t base_length) {
+  uint64 base_size;
+  uint64 base_hash;
+  return ParseDeltaHeader(delta, delta_length, &base_size, &base_hash) &&
+         base_size == base_length &&
+         base_hash == utils::HashContent(base, base_length, 0);
+}
+
+bool ApplyDelta(const char* base, size_t base_length, const char* delta,
+                size_t delta_length, std::string* result) {
+  if (!IsDeltaOfBase(delta, delta_length, base, base_length))
+    return false;
+  uint64 result_size = ReadUint(delta + 24, 8);
+  uint64 result_hash = ReadUint(delta + 32, 8);
+  uint64 block_size = ReadUint(delta + 40, 4);
+  if (block_size == 0)
+    return false;
+  const uint64 base_blocks = base_length / block_size;
+
+  result->clear();
+  // |result_size| comes from the delta, so only reserve what the base and
+  // the delta's literals could plausibly add up to.
+  result->reserve(static_cast<size_t>(
+      std::min<uint64>(result_size, base_length + delta_length)));
+  const char* op = delta + kDeltaHeaderSize;
+  const char* end = delta + delta_length;
+  while (op < end) {
+    char type = *op++;
+    uint64 first;
+    uint64 count;
+    if (type == kCopyBlocks) {
+      if (!ReadVarint(&op, end, &first) || !ReadVarint(&op, end, &count) ||
+          first > base_blocks || count > base_blocks - first ||
+          count * block_size > result_size - result->size()) {
+        return false;
+      }
+      result->append(base + first * block_size,
+                     static_cast<size_t>(count * block_size));
+    } else if (type == kLiteral) {
+      if (!ReadVarint(&op, end, &count) ||
+          count > static_cast<uint64>(end - op) ||
+          count > result_size - result->size()) {
+        return false;
+      }
+      result->append(op, static_cast<size_t>(count));
+      op += count;
+    } else {
+      return false;
+    }
+  }
+  return result->size() == result_size &&
+         utils::HashContent(result->data(), result->size(), 0) == result_hash;
+}
+
+}  // namespace greenworks
@@ -0,0 +1,60 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#ifndef SRC_GREENWORKS_CLOUD_DELTA_H_
+#define SRC_GREENWORKS_CLOUD_DELTA_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "steam/steamtypes.h"
+
+namespace greenworks {
+
+// rsync-style deltas between versions of a cloud file. The signature of a
+// base version holds a rolling (weak) and a strong checksum per block; the
+// delta of a newer version against it copies matching blocks of the base and
+// carries only the bytes in between.
+
+// The default block size of signatures.
+const uint32 kDefaultDeltaBlockSize = 2048;
+
+struct DeltaSignature {
+  uint32 block_size = 0;
+  uint64 base_size = 0;
+  uint64 base_hash = 0;
+  // The cloud timestamp of the base, telling whether it's still current.
+  int64 base_timestamp = 0;
+  std::vector<uint32> weak_checksums;
+  std::vector<uint64> strong_checksums;
+};
+
+// Computes the signature of |length| bytes of |data| with |block_size|
+// blocks. Only whole blocks are part of the signature.
+void ComputeDeltaSignature(const char* data, size_t length, uint32 block_size,
+                           DeltaSignature* signature);
+
+std::string SerializeDeltaSignature(const DeltaSignature& signature);
+
+bool ParseDeltaSignature(const char* data, size_t length,
+                         DeltaSignature* signature);
+
+// Computes the delta turning the base of |signature| into |length| bytes of
+// |data|.
+void ComputeDelta(const DeltaSignature& signature, const char* data,
+                  size_t length, std::string* delta);
+
+// Returns whether |delta| was computed against |base|.
+bool IsDeltaOfBase(const char* delta, size_t delta_length, const char* base,
+                   size_t base_length);
+
+// Applies |delta| to |base|. Fails if the delta wasn't computed against
+// |base|, or the result doesn't match the version it was computed from.
+bool ApplyDelta(const char* base, size_t base_length, const char* delta,
+                size_t delta_length, std::string* result);
+
+}  // namespace greenworks
+
+#endif  // SRC_GREENWORKS_CLOUD_DELTA_H_
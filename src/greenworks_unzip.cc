@@ -18,6 +18,15 @@
 
 #include "greenworks_unzip.h"
 
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "greenworks_zip_memory.h"
+
 #include "zlib/contrib/minizip/unzip.h"
 #include "zlib/zlib.h"
 
@@ -54,8 +63,7 @@
 #endif
 
 #define CASESENSITIVITY (0)
-#define WRITEBUFFERSIZE (8192)
-#define MAXFILENAME (256)
+#define WRITEBUFFERSIZE (65536)
 
 #ifdef _WIN32
 #define USEWIN32IOAPI
@@ -64,6 +72,22 @@
 
 namespace {
 
+// Converts an entry's local DOS time to seconds since the epoch.
+time_t DosTimeToTime(const tm_unz& tmu_date) {
+  struct tm newdate;
+  newdate.tm_sec = tmu_date.tm_sec;
+  newdate.tm_min = tmu_date.tm_min;
+  newdate.tm_hour = tmu_date.tm_hour;
+  newdate.tm_mday = tmu_date.tm_mday;
+  newdate.tm_mon = tmu_date.tm_mon;
+  if (tmu_date.tm_year > 1900)
+    newdate.tm_year = tmu_date.tm_year - 1900;
+  else
+    newdate.tm_year = tmu_date.tm_year;
+  newdate.tm_isdst = -1;
+  return mktime(&newdate);
+}
+
 /* change_file_date : change the date/time of a file
 filename : the filename of the file where date/time must be modified
 dosdate : the new date at the MSDos format (4 bytes)
@@ -81,19 +105,7 @@ void change_file_date(const char *filename, uLong dosdate, tm_unz tmu_date) {
   CloseHandle(hFile);
 #else
   struct utimbuf ut;
-  struct tm newdate;
-  newdate.tm_sec = tmu_date.tm_sec;
-  newdate.tm_min = tmu_date.tm_min;
-  newdate.tm_hour = tmu_date.tm_hour;
-  newdate.tm_mday = tmu_date.tm_mday;
-  newdate.tm_mon = tmu_date.tm_mon;
-  if (tmu_date.tm_year > 1900)
-    newdate.tm_year = tmu_date.tm_year - 1900;
-  else
-    newdate.tm_year = tmu_date.tm_year;
-  newdate.tm_isdst = -1;
-
-  ut.actime = ut.modtime = mktime(&newdate);
+  ut.actime = ut.modtime = DosTimeToTime(tmu_date);
   utime(filename, &ut);
 #endif
 }
@@ -108,157 +120,387 @@ int mymkdir(const char* dirname) {
   return ret;
 }
 
-int makedir(const char *newdir) {
-  char *buffer;
-  char *p;
-  auto len = (int)strlen(newdir);
+int myrmdir(const char* dirname) {
+#ifdef _WIN32
+  return _rmdir(dirname);
+#else
+  return rmdir(dirname);
+#endif
+}
 
-  if (len <= 0)
-    return 0;
+struct UnzipEntry {
+  unz64_file_pos pos;
+  std::string name;
+  unz_file_info64 info;
+  // The malloc'd content when extracting to memory.
+  char* content = nullptr;
+  // Whether the entry's file was created, to remove it on cancellation.
+  bool written = false;
+};
+
+struct UnzipJob {
+  std::string zipfilename;
+  // The memory archive's I/O, nullptr for files.
+  zlib_filefunc64_def* filefunc = nullptr;
+  std::string dirname;
+  bool to_memory = false;
+  const char* password;
+  std::vector<UnzipEntry> entries;
+  // Indices into |entries|, in extraction order.
+  std::vector<size_t> order;
+  std::atomic<size_t> next_entry{0};
+  std::atomic<bool> abort{false};
+  std::atomic<int> err{UNZ_OK};
+  // The directories made by MakeDirectories, parents first.
+  std::vector<std::string> created_dirs;
+  greenworks::ArchiveProgressTracker* progress = nullptr;
+};
+
+unzFile OpenZipFile(const char* zipfilename,
+                    zlib_filefunc64_def* filefunc = nullptr) {
+  if (filefunc)
+    return unzOpen2_64(zipfilename, filefunc);
+#ifdef USEWIN32IOAPI
+  zlib_filefunc64_def ffunc;
+  fill_win32_filefunc64A(&ffunc);
+  return unzOpen2_64(zipfilename, &ffunc);
+#else
+  return unzOpen64(zipfilename);
+#endif
+}
 
-  buffer = (char*)malloc(len + 1);
-  if (buffer == nullptr)
-    return UNZ_INTERNALERROR;
-  strcpy(buffer, newdir);
+// Reads the central directory record of the current file.
+int ReadCurrentEntry(unzFile uf, UnzipEntry* entry) {
+  int err = unzGetCurrentFileInfo64(uf, &entry->info, nullptr, 0, nullptr, 0,
+                                    nullptr, 0);
+  if (err != UNZ_OK)
+    return err;
+  entry->name.resize(entry->info.size_filename);
+  err = unzGetCurrentFileInfo64(uf, nullptr, &entry->name[0],
+                                entry->info.size_filename + 1, nullptr, 0,
+                                nullptr, 0);
+  if (err == UNZ_OK)
+    err = unzGetFilePos64(uf, &entry->pos);
+#ifndef _WIN32
+  std::replace(entry->name.begin(), entry->name.end(), '\\', '/');
+#endif
+  return err;
+}
 
-  if (buffer[len - 1] == '/')
-    buffer[len - 1] = '\0';
+// Reads all entries from the central directory.
+int ReadEntries(unzFile uf, std::vector<UnzipEntry>* entries) {
+  unz_global_info64 gi;
+  int err = unzGetGlobalInfo64(uf, &gi);
+  if (err != UNZ_OK)
+    return err;
 
-  if (mymkdir(buffer) == 0) {
-    free(buffer);
-    return 1;
+  entries->resize(gi.number_entry);
+  for (uLong i = 0; i < gi.number_entry; i++) {
+    err = ReadCurrentEntry(uf, &(*entries)[i]);
+    if (err != UNZ_OK)
+      return err;
+
+    if (i + 1 < gi.number_entry) {
+      err = unzGoToNextFile(uf);
+      if (err != UNZ_OK)
+        return err;
+    }
+  }
+  return UNZ_OK;
+}
+
+// Moves to the entry named |name|. Unlike unzLocateFile, the names aren't
+// limited in length and match the ones ReadEntries gives.
+int LocateEntry(unzFile uf, const char* name, UnzipEntry* entry) {
+  int err = unzGoToFirstFile(uf);
+  while (err == UNZ_OK) {
+    err = ReadCurrentEntry(uf, entry);
+    if (err != UNZ_OK || entry->name == name)
+      return err;
+    err = unzGoToNextFile(uf);
   }
+  return err;
+}
 
-  p = buffer + 1;
-  while (1) {
-    char hold;
-
-    while (*p && *p != '\\' && *p != '/')
-      p++;
-    hold = *p;
-    *p = 0;
-    if ((mymkdir(buffer) == -1) && (errno == ENOENT)) {
-      free(buffer);
-      return 0;
+// Matches |name| against a glob where '*' and '?' don't match '/', while
+// "**" matches across directories.
+bool GlobMatch(const char* pattern, const char* name) {
+  for (; *pattern; ++pattern, ++name) {
+    if (*pattern == '*') {
+      bool any = pattern[1] == '*';
+      pattern += any ? 2 : 1;
+      // "a/**/b" also matches "a/b".
+      if (any && *pattern == '/' && GlobMatch(pattern + 1, name))
+        return true;
+      for (;; ++name) {
+        if (GlobMatch(pattern, name))
+          return true;
+        if (*name == '\0' || (!any && *name == '/'))
+          return false;
+      }
     }
-    if (hold == 0)
-      break;
-    *p++ = hold;
+    if (*name == '\0')
+      return false;
+    if (*pattern == '?' ? *name == '/' : *pattern != *name)
+      return false;
   }
-  free(buffer);
-  return 1;
+  return *name == '\0';
 }
 
-int do_extract_currentfile(unzFile uf, const int* popt_extract_without_path,
-    int* popt_overwrite, const char* password) {
-  char filename_inzip[256];
-  char* filename_withoutpath;
-  char* p;
-  FILE *fout = nullptr;
-  void* buf;
+// Whether extracting an entry named |name| would write outside the target
+// directory: an absolute path, a drive letter or a ".." component.
+bool IsUnsafeEntryName(const std::string& name) {
+  if (!name.empty() && (name[0] == '/' || name[0] == '\\'))
+    return true;
+  if (name.size() > 1 && name[1] == ':')
+    return true;
+  size_t start = 0;
+  while (true) {
+    size_t separator = name.find_first_of("\\/", start);
+    if (name.compare(start, separator - start, "..") == 0)
+      return true;
+    if (separator == std::string::npos)
+      return false;
+    start = separator + 1;
+  }
+}
 
-  unz_file_info64 file_info;
-  int err = unzGetCurrentFileInfo64(uf, &file_info, filename_inzip,
-      sizeof(filename_inzip), nullptr, 0, nullptr, 0);
+// Returns UNZ_BADZIPFILE if any entry of |job| would be written outside its
+// target directory, before anything is written.
+int CheckEntryNames(const UnzipJob& job) {
+  for (const UnzipEntry& entry : job.entries) {
+    if (IsUnsafeEntryName(entry.name))
+      return UNZ_BADZIPFILE;
+  }
+  return UNZ_OK;
+}
 
-  if (err != UNZ_OK)
-    return err;
+// Makes the target directory and every directory of the entries before
+// extracting, so the extracting threads never race on them.
+void MakeDirectories(UnzipJob* job) {
+  for (size_t separator = job->dirname.find_first_of("\\/", 1);;
+       separator = job->dirname.find_first_of("\\/", separator + 1)) {
+    std::string dir = job->dirname.substr(0, separator);
+    if (mymkdir(dir.c_str()) == 0)
+      job->created_dirs.push_back(dir);
+    if (separator == std::string::npos)
+      break;
+  }
 
-  uInt size_buf = WRITEBUFFERSIZE;
-  buf = (void*)malloc(size_buf);
-  if (buf == nullptr)
-    return UNZ_INTERNALERROR;
+  // Sorted, each directory comes after its parents.
+  std::vector<std::string> dirs;
+  for (const UnzipEntry& entry : job->entries) {
+    for (size_t separator = entry.name.find_first_of("\\/");
+         separator != std::string::npos;
+         separator = entry.name.find_first_of("\\/", separator + 1))
+      dirs.push_back(entry.name.substr(0, separator));
+  }
+  std::sort(dirs.begin(), dirs.end());
+  dirs.erase(std::unique(dirs.begin(), dirs.end()), dirs.end());
+  for (const std::string& dir : dirs) {
+    std::string path = job->dirname + "/" + dir;
+    if (mymkdir(path.c_str()) == 0)
+      job->created_dirs.push_back(path);
+  }
+}
 
-  p = filename_withoutpath = filename_inzip;
-  while ((*p) != '\0') {
-    if (((*p) == '/') || ((*p) == '\\')) {
-#ifndef _WIN32
-      (*p) = '/';
-#endif
-      filename_withoutpath = p + 1;
-    }
-    p++;
+// Removes what a cancelled job extracted: the files it wrote, then the
+// directories it made, children first.
+void RemoveOutput(const UnzipJob& job) {
+  for (const UnzipEntry& entry : job.entries) {
+    if (entry.written)
+      remove((job.dirname + "/" + entry.name).c_str());
   }
+  for (auto dir = job.created_dirs.rbegin(); dir != job.created_dirs.rend();
+       ++dir)
+    myrmdir(dir->c_str());
+}
+
+// Inflates the current file straight into a buffer of the size recorded in
+// the central directory.
+int ReadEntryToMemory(unzFile uf, UnzipEntry& entry) {
+  ZPOS64_T size = entry.info.uncompressed_size;
+  if (size > (size_t)-1 - 1)
+    return UNZ_INTERNALERROR;
+  entry.content = (char*)malloc(size ? (size_t)size : 1);
+  if (entry.content == nullptr)
+    return UNZ_INTERNALERROR;
 
-  if ((*filename_withoutpath) == '\0') {
-    if ((*popt_extract_without_path) == 0)
-      mymkdir(filename_inzip);
+  ZPOS64_T size_read = 0;
+  int err = UNZ_OK;
+  while (size_read < size) {
+    ZPOS64_T chunk = size - size_read;
+    if (chunk > 0x40000000)
+      chunk = 0x40000000;
+    err = unzReadCurrentFile(uf, entry.content + size_read, (unsigned)chunk);
+    if (err <= 0)
+      break;
+    size_read += err;
   }
-  else {
-    const char* write_filename;
-    if ((*popt_extract_without_path) == 0)
-      write_filename = filename_inzip;
-    else
-      write_filename = filename_withoutpath;
-
-    err = unzOpenCurrentFilePassword(uf, password);
-    if (err == UNZ_OK) {
-      fout = fopen64(write_filename, "wb");
-
-      /* some zipfile don't contain directory alone before file */
-      if ((fout == nullptr) && ((*popt_extract_without_path) == 0) &&
-        (filename_withoutpath != (char*)filename_inzip))
-      {
-        char c = *(filename_withoutpath - 1);
-        *(filename_withoutpath - 1) = '\0';
-        makedir(write_filename);
-        *(filename_withoutpath - 1) = c;
-        fout = fopen64(write_filename, "wb");
-      }
-    }
+  if (err < 0)
+    return err;
+  // The data must end exactly where the central directory says.
+  char extra;
+  if (size_read != size || unzReadCurrentFile(uf, &extra, 1) != 0)
+    return UNZ_BADZIPFILE;
+  return UNZ_OK;
+}
 
-    if (fout != nullptr) {
-      do {
-        err = unzReadCurrentFile(uf, buf, size_buf);
-        if (err<0)
-          break;
-        if (err>0)
-          if (fwrite(buf, err, 1, fout) != 1) {
-            err = UNZ_ERRNO;
-            break;
-          }
-      } while (err>0);
-      if (fout)
-        fclose(fout);
-
-      if (err == 0)
-        change_file_date(write_filename, file_info.dosDate,
-        file_info.tmu_date);
-    }
+// Returned by ExtractEntry when another thread's error stopped it.
+const int kExtractAborted = -1001;
 
+// Records |err| as the job's error, unless another thread failed first.
+void SetJobError(UnzipJob* job, int err) {
+  int expected = UNZ_OK;
+  job->err.compare_exchange_strong(expected, err);
+  job->abort = true;
+}
+
+int ExtractEntry(unzFile uf, UnzipEntry& entry, UnzipJob* job,
+                 std::vector<char>* buf) {
+  if (job->progress->cancelled())
+    return greenworks::kArchiveCancelled;
+  // Directories were made up front.
+  if (entry.name.empty() || entry.name.back() == '/' ||
+      entry.name.back() == '\\')
+    return UNZ_OK;
+
+  int err = unzGoToFilePos64(uf, &entry.pos);
+  if (err != UNZ_OK)
+    return err;
+  err = unzOpenCurrentFilePassword(uf, job->password);
+  if (err != UNZ_OK)
+    return err;
+
+  if (job->to_memory) {
+    err = ReadEntryToMemory(uf, entry);
+    job->progress->AddBytes(entry.info.uncompressed_size);
     if (err == UNZ_OK)
       err = unzCloseCurrentFile(uf);
     else
       unzCloseCurrentFile(uf); /* don't lose the error */
+    return err;
   }
 
-  free(buf);
-  return err;
-}
+  std::string write_filename = job->dirname + "/" + entry.name;
+  FILE* fout = fopen64(write_filename.c_str(), "wb");
+  if (fout == nullptr) {
+    unzCloseCurrentFile(uf);
+    return UNZ_ERRNO;
+  }
+  entry.written = true;
 
-int do_extract(unzFile uf, int opt_extract_without_path,
-    int opt_overwrite, const char* password) {
-  uLong i;
-  unz_global_info64 gi;
+  do {
+    if (job->progress->cancelled()) {
+      err = greenworks::kArchiveCancelled;
+      break;
+    }
+    err = unzReadCurrentFile(uf, buf->data(), (unsigned)buf->size());
+    if (err < 0)
+      break;
+    if (err > 0) {
+      if (fwrite(buf->data(), err, 1, fout) != 1) {
+        err = UNZ_ERRNO;
+        break;
+      }
+      job->progress->AddBytes(err);
+    }
+    if (err > 0 && job->abort)
+      err = kExtractAborted;
+  } while (err > 0);
+  fclose(fout);
 
-  int err = unzGetGlobalInfo64(uf, &gi);
-  if (err != UNZ_OK)
-    return err;
+  if (err == UNZ_OK)
+    err = unzCloseCurrentFile(uf);
+  else
+    unzCloseCurrentFile(uf); /* don't lose the error */
+
+  if (err == UNZ_OK) {
+    change_file_date(write_filename.c_str(), entry.info.dosDate,
+                     entry.info.tmu_date);
+  } else {
+    // Don't leave a truncated or corrupt file behind.
+    remove(write_filename.c_str());
+    entry.written = false;
+  }
+  return err;
+}
 
-  for (i = 0; i < gi.number_entry; i++) {
-    err = do_extract_currentfile(uf, &opt_extract_without_path, &opt_overwrite,
-        password);
-    if (err != UNZ_OK)
-      return err;
+void ExtractEntries(UnzipJob* job) {
+  unzFile uf = OpenZipFile(job->zipfilename.c_str(), job->filefunc);
+  if (uf == nullptr) {
+    SetJobError(job, UNZ_ERRNO);
+    return;
+  }
 
-    if (i + 1 < gi.number_entry) {
-      err = unzGoToNextFile(uf);
-      if (err != UNZ_OK)
-        return err;
+  std::vector<char> buf(WRITEBUFFERSIZE);
+  while (!job->abort) {
+    size_t index = job->next_entry++;
+    if (index >= job->order.size())
+      break;
+    int err = ExtractEntry(uf, job->entries[job->order[index]], job, &buf);
+    if (err != UNZ_OK) {
+      SetJobError(job, err);
+    } else {
+      job->progress->AddEntry();
     }
   }
+  unzClose(uf);
+}
+
+// Keeps only the last of the entries with the same name, the one sequential
+// extraction leaves on disk, so no two threads write the same file.
+void RemoveDuplicateEntries(std::vector<UnzipEntry>* entries) {
+  std::unordered_set<std::string> seen;
+  std::vector<UnzipEntry> unique;
+  for (auto entry = entries->rbegin(); entry != entries->rend(); ++entry) {
+    if (seen.insert(entry->name).second)
+      unique.push_back(std::move(*entry));
+  }
+  std::reverse(unique.begin(), unique.end());
+  entries->swap(unique);
+}
 
-  return 0;
+void RunJob(UnzipJob* job, const greenworks::UnzipOptions& options) {
+  RemoveDuplicateEntries(&job->entries);
+  greenworks::ArchiveProgressTracker progress(options.progress,
+                                              options.cancel);
+  uint64_t total_bytes = 0;
+  for (const UnzipEntry& entry : job->entries)
+    total_bytes += entry.info.uncompressed_size;
+  progress.SetTotals(total_bytes, job->entries.size());
+  job->progress = &progress;
+
+  job->order.resize(job->entries.size());
+  for (size_t i = 0; i < job->order.size(); ++i)
+    job->order[i] = i;
+  // Start the largest entries first, so one big file doesn't finish last on
+  // its own.
+  std::stable_sort(job->order.begin(), job->order.end(),
+      [job](size_t a, size_t b) {
+        return job->entries[a].info.uncompressed_size >
+               job->entries[b].info.uncompressed_size;
+      });
+
+  size_t num_threads = options.num_threads > 0 ? options.num_threads : std::thread::hardware_concurrency();
+  if (num_threads == 0)
+    num_threads = 1;
+  if (num_threads > job->entries.size())
+    num_threads = job->entries.size();
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < num_threads; ++i)
+    threads.emplace_back(ExtractEntries, job);
+  for (std::thread& thread : threads)
+    thread.join();
+
+  if (job->err == UNZ_OK) {
+    progress.Finish();
+  } else if (progress.cancelled()) {
+    job->err = greenworks::kArchiveCancelled;
+    RemoveOutput(*job);
+  }
+  job->progress = nullptr;
 }
 
 }
@@ -266,50 +508,180 @@ int do_extract(unzFile uf, int opt_extract_without_path,
 namespace greenworks {
 
 int unzip(const char *zipfilename, const char *dirname, const char *password) {
-  char filename_try[MAXFILENAME + 16] = "";
+  UnzipOptions options;
+  options.password = password;
+  return unzip(zipfilename, dirname, options);
+}
+
+int unzip(const char *zipfilename, const char *dirname,
+          const UnzipOptions& options) {
+  std::string filename_try;
   unzFile uf = nullptr;
-  int ret_value = 0;
 
   if (zipfilename != nullptr) {
-#ifdef USEWIN32IOAPI
-    zlib_filefunc64_def ffunc;
-#endif
-
-    strncpy(filename_try, zipfilename, MAXFILENAME - 1);
-    //strncpy doesnt append the trailing NULL, of the string is too long.
-    filename_try[MAXFILENAME] = '\0';
-
-#ifdef USEWIN32IOAPI
-    fill_win32_filefunc64A(&ffunc);
-    uf = unzOpen2_64(zipfilename, &ffunc);
-#else
-    uf = unzOpen64(zipfilename);
-#endif
+    filename_try = zipfilename;
+    uf = OpenZipFile(filename_try.c_str());
     if (uf == nullptr) {
-      strcat(filename_try, ".zip");
-#ifdef USEWIN32IOAPI
-      uf = unzOpen2_64(filename_try, &ffunc);
-#else
-      uf = unzOpen64(filename_try);
-#endif
+      filename_try += ".zip";
+      uf = OpenZipFile(filename_try.c_str());
     }
   }
 
   if (uf == nullptr)
     return 1;
 
-#ifdef _WIN32
-  if (_chdir(dirname)) {
-#else
-  if (chdir(dirname)) {
-#endif
-    return 1;
+  UnzipJob job;
+  job.zipfilename = filename_try;
+  job.dirname = dirname;
+  job.password = (options.password != nullptr && strlen(options.password) > 0) ? options.password : nullptr;
+  int err = ReadEntries(uf, &job.entries);
+  unzClose(uf);
+  if (err == UNZ_OK)
+    err = CheckEntryNames(job);
+  if (err != UNZ_OK)
+    return err;
+
+  MakeDirectories(&job);
+  RunJob(&job, options);
+  return job.err;
+}
+
+int unzipFromMemory(const char* archive, size_t archive_size,
+                    const UnzipOptions& options,
+                    std::vector<UnzippedEntry>* entries) {
+  MemoryArchive memory;
+  memory.data = const_cast<char*>(archive);
+  memory.size = archive_size;
+  zlib_filefunc64_def ffunc;
+  FillMemoryFileFunc(&ffunc, &memory);
+
+  unzFile uf = OpenZipFile("", &ffunc);
+  if (uf == nullptr)
+    return UNZ_BADZIPFILE;
+
+  UnzipJob job;
+  job.filefunc = &ffunc;
+  job.to_memory = true;
+  job.password = (options.password != nullptr && strlen(options.password) > 0) ? options.password : nullptr;
+  int err = ReadEntries(uf, &job.entries);
+  unzClose(uf);
+  if (err != UNZ_OK)
+    return err;
+
+  RunJob(&job, options);
+
+  for (UnzipEntry& entry : job.entries) {
+    if (job.err == UNZ_OK && entry.content) {
+      UnzippedEntry result;
+      result.name = entry.name;
+      result.data = entry.content;
+      result.size = entry.info.uncompressed_size;
+      entries->push_back(result);
+    } else {
+      free(entry.content);
+    }
   }
+  return job.err;
+}
 
-  ret_value = do_extract(uf, 0, 1, password);
+int listArchive(const char* zipfilename, ArchiveListing* listing) {
+  unzFile uf = OpenZipFile(zipfilename);
+  if (uf == nullptr)
+    return UNZ_ERRNO;
+  std::vector<UnzipEntry> entries;
+  int err = ReadEntries(uf, &entries);
   unzClose(uf);
+  if (err != UNZ_OK)
+    return err;
+
+  listing->names.reserve(entries.size());
+  listing->sizes.reserve(entries.size());
+  listing->compressed_sizes.reserve(entries.size());
+  listing->crcs.reserve(entries.size());
+  listing->mtimes.reserve(entries.size());
+  for (UnzipEntry& entry : entries) {
+    listing->names.push_back(std::move(entry.name));
+    listing->sizes.push_back(entry.info.uncompressed_size);
+    listing->compressed_sizes.push_back(entry.info.compressed_size);
+    listing->crcs.push_back(entry.info.crc);
+    listing->mtimes.push_back(DosTimeToTime(entry.info.tmu_date));
+  }
+  return UNZ_OK;
+}
 
-  return ret_value;
+int unzipEntries(const char* zipfilename, const char* dirname,
+                 const std::vector<std::string>& names, bool glob,
+                 const UnzipOptions& options) {
+  unzFile uf = OpenZipFile(zipfilename);
+  if (uf == nullptr)
+    return UNZ_ERRNO;
+
+  UnzipJob job;
+  job.zipfilename = zipfilename;
+  job.dirname = dirname;
+  job.password = (options.password != nullptr && strlen(options.password) > 0) ? options.password : nullptr;
+  int err = ReadEntries(uf, &job.entries);
+  unzClose(uf);
+  if (err != UNZ_OK)
+    return err;
+
+  std::unordered_set<std::string> wanted;
+  std::unordered_set<std::string> missing;
+  if (!glob) {
+    wanted.insert(names.begin(), names.end());
+    missing = wanted;
+  }
+  auto unselected = [&](const UnzipEntry& entry) {
+    if (!glob) {
+      missing.erase(entry.name);
+      return wanted.count(entry.name) == 0;
+    }
+    for (const std::string& pattern : names)
+      if (GlobMatch(pattern.c_str(), entry.name.c_str()))
+        return false;
+    return true;
+  };
+  job.entries.erase(std::remove_if(job.entries.begin(), job.entries.end(),
+                                   unselected),
+                    job.entries.end());
+  if (!missing.empty())
+    return UNZ_END_OF_LIST_OF_FILE;
+  err = CheckEntryNames(job);
+  if (err != UNZ_OK)
+    return err;
+
+  MakeDirectories(&job);
+  RunJob(&job, options);
+  return job.err;
+}
+
+int readEntry(const char* zipfilename, const char* name, const char* password,
+              char** data, size_t* size) {
+  unzFile uf = OpenZipFile(zipfilename);
+  if (uf == nullptr)
+    return UNZ_ERRNO;
+
+  UnzipEntry entry;
+  int err = LocateEntry(uf, name, &entry);
+  if (err == UNZ_OK) {
+    err = unzOpenCurrentFilePassword(
+        uf, (password != nullptr && strlen(password) > 0) ? password : nullptr);
+  }
+  if (err == UNZ_OK) {
+    err = ReadEntryToMemory(uf, entry);
+    if (err == UNZ_OK)
+      err = unzCloseCurrentFile(uf);
+    else
+      unzCloseCurrentFile(uf); /* don't lose the error */
+  }
+  unzClose(uf);
+  if (err != UNZ_OK) {
+    free(entry.content);
+    return err;
+  }
+  *data = entry.content;
+  *size = entry.info.uncompressed_size;
+  return UNZ_OK;
 }
 
 }  // namespace greenworks
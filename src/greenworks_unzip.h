@@ -19,10 +19,76 @@
 #ifndef GREENWORKS_UNZIP_H_
 #define GREENWORKS_UNZIP_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "greenworks_archive_progress.h"
+
 namespace greenworks {
 
+struct UnzipOptions {
+  // nullptr or empty for no password.
+  const char* password = nullptr;
+  // The number of extracting threads, 0 for one per core.
+  int num_threads = 0;
+  // Called with the job's progress from its threads, see
+  // ArchiveProgressTracker.
+  ArchiveProgressCallback progress;
+  // Stops the job once set, between blocks. The job then fails with
+  // kArchiveCancelled after removing what it wrote.
+  const std::atomic<bool>* cancel = nullptr;
+};
+
 int unzip(const char *zipfilename, const char *dirname, const char *password);
 
+// Reads the central directory once and extracts the entries on
+// |options.num_threads| threads, each with its own handle on the archive.
+int unzip(const char *zipfilename, const char *dirname,
+          const UnzipOptions& options);
+
+struct UnzippedEntry {
+  std::string name;
+  // malloc'd, owned by the caller.
+  char* data;
+  size_t size;
+};
+
+// Extracts the files of the archive in |archive| to memory, in archive order.
+// Directory entries are skipped.
+int unzipFromMemory(const char* archive, size_t archive_size,
+                    const UnzipOptions& options,
+                    std::vector<UnzippedEntry>* entries);
+
+// The central directory of an archive, one element per entry in archive
+// order.
+struct ArchiveListing {
+  std::vector<std::string> names;
+  std::vector<uint64_t> sizes;
+  std::vector<uint64_t> compressed_sizes;
+  std::vector<uint32_t> crcs;
+  // Seconds since the epoch, from the entries' local DOS times.
+  std::vector<time_t> mtimes;
+};
+
+// Lists the entries from the central directory, without reading their data.
+int listArchive(const char* zipfilename, ArchiveListing* listing);
+
+// Extracts the entries whose names are in |names| to |dirname|, or those
+// matching the |names| globs if |glob| is set. In globs '*' and '?' don't
+// match '/', while "**" does. Only the selected entries are read. Fails
+// before extracting anything if an exact name is missing.
+int unzipEntries(const char* zipfilename, const char* dirname,
+                 const std::vector<std::string>& names, bool glob,
+                 const UnzipOptions& options);
+
+// Reads the entry named |name| to memory. On success |data| holds a malloc'd
+// buffer of |size| bytes that the caller frees.
+int readEntry(const char* zipfilename, const char* name, const char* password,
+              char** data, size_t* size);
+
 }  // namespace greenworks
 
 #endif  // GREENWORKS_UNZIP_H_
@@ -4,6 +4,7 @@
 
 #include "greenworks_utils.h"
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -17,6 +18,47 @@
 #include <utime.h>
 #endif
 
+namespace {
+
+const uint64 kPrime64_1 = 11400714785074694791ULL;
+const uint64 kPrime64_2 = 14029467366897019727ULL;
+const uint64 kPrime64_3 = 1609587929392839161ULL;
+const uint64 kPrime64_4 = 9650029242287828579ULL;
+const uint64 kPrime64_5 = 2870177450012600261ULL;
+
+// The chunk size HashFile reads files with.
+const size_t kHashChunkSize = 1024 * 1024;
+
+inline uint64 RotateLeft(uint64 value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// Reads little-endian values, which all supported platforms are.
+inline uint64 Read64(const char* data) {
+  uint64 value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+inline uint32 Read32(const char* data) {
+  uint32 value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+inline uint64 HashRound(uint64 acc, uint64 input) {
+  acc += input * kPrime64_2;
+  acc = RotateLeft(acc, 31);
+  return acc * kPrime64_1;
+}
+
+inline uint64 MergeRound(uint64 acc, uint64 value) {
+  acc ^= HashRound(0, value);
+  return acc * kPrime64_1 + kPrime64_4;
+}
+
+}  // namespace
+
 namespace utils {
 
 void sleep(int milliseconds) {
@@ -66,6 +108,83 @@ int64 GetFileLastUpdatedTime(const char* file_path) {
   return st.st_mtime;
 }
 
+bool GetFileSizeAndTime(const char* file_path, int64* size, int64* mtime) {
+  struct stat st;
+  if (stat(file_path, &st))
+    return false;
+  *size = st.st_size;
+  *mtime = st.st_mtime;
+  return true;
+}
+
+bool HashFile(const char* file_path, uint64* hash) {
+  std::ifstream fin(file_path, std::ios::in|std::ios::binary);
+  if (!fin.is_open())
+    return false;
+  std::string chunk(kHashChunkSize, '\0');
+  uint64 result = 0;
+  while (fin) {
+    fin.read(&chunk[0], chunk.size());
+    std::streamsize length = fin.gcount();
+    if (length > 0)
+      result = HashContent(chunk.data(), static_cast<size_t>(length), result);
+  }
+  if (fin.bad())
+    return false;
+  *hash = result;
+  return true;
+}
+
+uint64 HashContent(const char* data, size_t length, uint64 seed) {
+  const char* end = data + length;
+  uint64 hash;
+  if (length >= 32) {
+    // Four independent lanes, which the compiler can interleave.
+    uint64 v1 = seed + kPrime64_1 + kPrime64_2;
+    uint64 v2 = seed + kPrime64_2;
+    uint64 v3 = seed;
+    uint64 v4 = seed - kPrime64_1;
+    const char* limit = end - 32;
+    do {
+      v1 = HashRound(v1, Read64(data));
+      v2 = HashRound(v2, Read64(data + 8));
+      v3 = HashRound(v3, Read64(data + 16));
+      v4 = HashRound(v4, Read64(data + 24));
+      data += 32;
+    } while (data <= limit);
+    hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) +
+           RotateLeft(v4, 18);
+    hash = MergeRound(hash, v1);
+    hash = MergeRound(hash, v2);
+    hash = MergeRound(hash, v3);
+    hash = MergeRound(hash, v4);
+  } else {
+    hash = seed + kPrime64_5;
+  }
+  hash += length;
+
+  for (; data + 8 <= end; data += 8) {
+    hash ^= HashRound(0, Read64(data));
+    hash = RotateLeft(hash, 27) * kPrime64_1 + kPrime64_4;
+  }
+  if (data + 4 <= end) {
+    hash ^= static_cast<uint64>(Read32(data)) * kPrime64_1;
+    hash = RotateLeft(hash, 23) * kPrime64_2 + kPrime64_3;
+    data += 4;
+  }
+  for (; data < end; ++data) {
+    hash ^= static_cast<uint8>(*data) * kPrime64_5;
+    hash = RotateLeft(hash, 11) * kPrime64_1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime64_2;
+  hash ^= hash >> 29;
+  hash *= kPrime64_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
 std::string uint64ToString(uint64 value) {
   return std::to_string(value);
 }
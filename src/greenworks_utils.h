@@ -23,6 +23,16 @@ bool UpdateFileLastUpdatedTime(const char* file_path, time_t time);
 
 int64 GetFileLastUpdatedTime(const char* file_path);
 
+// Gets the size and last modification time of a local file.
+bool GetFileSizeAndTime(const char* file_path, int64* size, int64* mtime);
+
+// Computes a 64-bit hash of a file's content, reading it in chunks. Each chunk
+// is hashed with XXH64, seeded with the hash of the chunks before it.
+bool HashFile(const char* file_path, uint64* hash);
+
+// Computes the XXH64 hash of |length| bytes of |data|.
+uint64 HashContent(const char* data, size_t length, uint64 seed);
+
 std::string uint64ToString(uint64 value);
 
 uint64 strToUint64(std::string);
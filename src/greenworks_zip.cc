@@ -18,11 +18,23 @@
 
 #include "greenworks_zip.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <cstring>
 
+#include "greenworks_zip_memory.h"
 #include "zlib/zlib.h"
+#include "zlib/contrib/minizip/unzip.h"
 #include "zlib/contrib/minizip/zip.h"
 
 #ifndef _WIN32
@@ -50,9 +62,9 @@
 #ifdef _WIN32
   #include <direct.h>
   #include <io.h>
-  #include "misc/dirent.h"
 #else
   #include <dirent.h>
+  #include <sys/mman.h>
   #include <sys/types.h>
   #include <sys/stat.h>
   #include <unistd.h>
@@ -63,213 +75,750 @@
 #include "zlib/contrib/minizip/iowin32.h"
 #endif
 
-#define WRITEBUFFERSIZE (16384)
-#define MAXFILENAME (256)
+#define WRITEBUFFERSIZE (65536)
 
 namespace {
 
-#ifdef _WIN32
-/* char *f: name of file to get info on */
+/* time_t mtime: modification time from the directory scan */
 /* tm_zip *tmzip: return value: access, modific. and creation times */
-/* uLong *dt: dostime */
-uLong filetime(const char *f, tm_zip *tmzip, uLong *dt)
+void filetime(time_t mtime, tm_zip *tmzip)
 {
-  int ret = 0;
-  {
-    FILETIME ftLocal;
-    HANDLE hFind;
-    WIN32_FIND_DATAA ff32;
+  struct tm filedate;
+  /* localtime() isn't safe on the compressing threads. */
+#ifdef _WIN32
+  localtime_s(&filedate, &mtime);
+#else
+  localtime_r(&mtime, &filedate);
+#endif
 
-    hFind = FindFirstFileA(f, &ff32);
-    if (hFind != INVALID_HANDLE_VALUE)
-    {
-      FileTimeToLocalFileTime(&(ff32.ftLastWriteTime), &ftLocal);
-      FileTimeToDosDateTime(&ftLocal, ((LPWORD)dt) + 1, ((LPWORD)dt) + 0);
-      FindClose(hFind);
-      ret = 1;
-    }
-  }
-  return ret;
+  tmzip->tm_sec = filedate.tm_sec;
+  tmzip->tm_min = filedate.tm_min;
+  tmzip->tm_hour = filedate.tm_hour;
+  tmzip->tm_mday = filedate.tm_mday;
+  tmzip->tm_mon = filedate.tm_mon;
+  tmzip->tm_year = filedate.tm_year;
 }
+
+struct ScannedFile {
+  std::string path;
+  ZPOS64_T size;
+  time_t mtime;
+};
+
+#ifdef _WIN32
+const char kPathSeparator = '\\';
 #else
-uLong filetime(const char *f, tm_zip *tmzip, uLong *dt)
-{
-  int ret = 0;
-  struct stat s;        /* results of stat() */
-  struct tm* filedate;
-  time_t tm_t = 0;
-
-  if (strcmp(f, "-") != 0)
-  {
-    char name[MAXFILENAME + 1];
-    int len = strlen(f);
-    if (len > MAXFILENAME)
-      len = MAXFILENAME;
-
-    strncpy(name, f, MAXFILENAME - 1);
-    /* strncpy doesnt append the trailing NULL, of the string is too long. */
-    name[MAXFILENAME] = '\0';
-
-    if (name[len - 1] == '/')
-      name[len - 1] = '\0';
-    /* not all systems allow stat'ing a file with / appended */
-    if (stat(name, &s) == 0)
-    {
-      tm_t = s.st_mtime;
-      ret = 1;
-    }
-  }
-  filedate = localtime(&tm_t);
+const char kPathSeparator = '/';
+#endif
 
-  tmzip->tm_sec = filedate->tm_sec;
-  tmzip->tm_min = filedate->tm_min;
-  tmzip->tm_hour = filedate->tm_hour;
-  tmzip->tm_mday = filedate->tm_mday;
-  tmzip->tm_mon = filedate->tm_mon;
-  tmzip->tm_year = filedate->tm_year;
+#ifndef _WIN32
+// An open directory, kept open while its subdirectories wait to be scanned
+// so they can be opened relative to it.
+struct OpenDirectory {
+  explicit OpenDirectory(DIR* dir) : dir(dir) {}
+  ~OpenDirectory() { closedir(dir); }
+  DIR* dir;
+};
+#endif
 
-  return ret;
-}
+struct PendingDirectory {
+  std::string path;
+#ifndef _WIN32
+  // The parent directory and the name in it, unset for the root.
+  std::shared_ptr<OpenDirectory> parent;
+  std::string name;
+#endif
+};
+
+// Lists the files under |dir| without recursing, taking each file's size and
+// time from the directory listing itself (fstatat() relative to the open
+// directory on POSIX, the find data on Windows), so nothing is stat'ed again
+// later. Entries are sorted by name, so the same tree always gives the same
+// archive. Symlinks and junctions are followed, visiting each directory once,
+// and links whose target doesn't exist are skipped.
+int ScanDirectory(const std::string& dir, std::vector<ScannedFile>* files) {
+  std::vector<PendingDirectory> pending(1);
+  pending[0].path = dir;
+  // The directories scanned so far, by device and inode (volume and file
+  // index on Windows), so links back into the tree don't loop.
+#ifdef _WIN32
+  std::set<std::pair<DWORD, uint64_t>> visited;
+#else
+  std::set<std::pair<dev_t, ino_t>> visited;
 #endif
 
-/* calculate the CRC32 of a file, because to encrypt a file, we need known the CRC32 of the file before */
-int getFileCrc(const char* filenameinzip, void* buf, unsigned long size_buf, unsigned long* result_crc)
-{
-  unsigned long calculate_crc = 0;
-  int err = ZIP_OK;
-  FILE * fin = fopen(filenameinzip, "rb");
-  unsigned long size_read = 0;
-  unsigned long total_read = 0;
-  if (fin == nullptr)
-  {
-    err = ZIP_ERRNO;
-  }
+  while (!pending.empty()) {
+    PendingDirectory current = std::move(pending.back());
+    pending.pop_back();
+    std::vector<PendingDirectory> subdirs;
+    std::vector<ScannedFile> current_files;
 
-  if (err == ZIP_OK)
-    do
-    {
-      err = ZIP_OK;
-      size_read = (int)fread(buf, 1, size_buf, fin);
-      if (size_read < size_buf)
-        if (feof(fin) == 0)
-        {
-          err = ZIP_ERRNO;
-        }
+#ifdef _WIN32
+    HANDLE hDir = CreateFileA(current.path.c_str(), 0,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+        OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (hDir == INVALID_HANDLE_VALUE) {
+      DWORD error = GetLastError();
+      // A junction or symlink to a directory that doesn't exist. Only the
+      // root is scanned before anything is visited.
+      if (!visited.empty() &&
+          (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND))
+        continue;
+      return ZIP_ERRNO;
+    }
+    BY_HANDLE_FILE_INFORMATION dir_info;
+    BOOL has_dir_info = GetFileInformationByHandle(hDir, &dir_info);
+    CloseHandle(hDir);
+    if (!has_dir_info)
+      return ZIP_ERRNO;
+    uint64_t file_index =
+        (static_cast<uint64_t>(dir_info.nFileIndexHigh) << 32) |
+        dir_info.nFileIndexLow;
+    if (!visited.insert(std::make_pair(dir_info.dwVolumeSerialNumber,
+                                       file_index)).second) {
+      // A junction or symlink back into the tree.
+      continue;
+    }
 
-      if (size_read>0)
-        calculate_crc = crc32(calculate_crc, (const Bytef*)buf, size_read);
-      total_read += size_read;
+    WIN32_FIND_DATAA ff32;
+    HANDLE hFind = FindFirstFileA((current.path + "\\*").c_str(), &ff32);
+    if (hFind == INVALID_HANDLE_VALUE)
+      return ZIP_ERRNO;
+    do {
+      if (strcmp(ff32.cFileName, ".") == 0 || strcmp(ff32.cFileName, "..") == 0)
+        continue;
+      std::string path = current.path + kPathSeparator + ff32.cFileName;
+      if (ff32.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+        PendingDirectory subdir;
+        subdir.path = path;
+        subdirs.push_back(std::move(subdir));
+        continue;
+      }
+      ULARGE_INTEGER time;
+      time.LowPart = ff32.ftLastWriteTime.dwLowDateTime;
+      time.HighPart = ff32.ftLastWriteTime.dwHighDateTime;
+      ScannedFile file;
+      file.path = path;
+      file.size = ((ZPOS64_T)ff32.nFileSizeHigh << 32) | ff32.nFileSizeLow;
+      // FILETIME counts 100ns intervals since 1601.
+      file.mtime = (time_t)((time.QuadPart - 116444736000000000ULL) / 10000000);
+      current_files.push_back(file);
+    } while (FindNextFileA(hFind, &ff32));
+    FindClose(hFind);
+#else
+    // Symlinks are followed on purpose, so no O_NOFOLLOW; the visited set
+    // stops loops.
+    const int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+    int fd = current.parent ?
+        openat(dirfd(current.parent->dir), current.name.c_str(), flags) :
+        open(current.path.c_str(), flags);
+    current.parent.reset();
+    if (fd < 0)
+      return ZIP_ERRNO;
+    struct stat s;
+    if (fstat(fd, &s) != 0) {
+      close(fd);
+      return ZIP_ERRNO;
+    }
+    if (!visited.insert(std::make_pair(s.st_dev, s.st_ino)).second) {
+      // A symlink back into the tree.
+      close(fd);
+      continue;
+    }
 
-    } while ((err == ZIP_OK) && (size_read>0));
+    DIR* d = fdopendir(fd);
+    if (d == nullptr) {
+      close(fd);
+      return ZIP_ERRNO;
+    }
+    auto opened = std::make_shared<OpenDirectory>(d);
+    struct dirent* entry;
+    while ((entry = readdir(d)) != nullptr) {
+      if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+        continue;
+      if (fstatat(dirfd(d), entry->d_name, &s, 0) != 0) {
+        // A symlink whose target doesn't exist, or a chain of symlinks that
+        // loops, is skipped; anything else that can't be stat'ed fails.
+        if ((errno != ENOENT && errno != ELOOP) ||
+            fstatat(dirfd(d), entry->d_name, &s, AT_SYMLINK_NOFOLLOW) != 0 ||
+            !S_ISLNK(s.st_mode)) {
+          return ZIP_ERRNO;
+        }
+        continue;
+      }
+      std::string path = current.path + kPathSeparator + entry->d_name;
+      if (S_ISDIR(s.st_mode)) {
+        PendingDirectory subdir;
+        subdir.path = path;
+        subdir.parent = opened;
+        subdir.name = entry->d_name;
+        subdirs.push_back(std::move(subdir));
+      } else if (S_ISREG(s.st_mode)) {
+        // Pipes, sockets and devices would block or never end.
+        ScannedFile file;
+        file.path = path;
+        file.size = s.st_size;
+        file.mtime = s.st_mtime;
+        current_files.push_back(file);
+      }
+    }
+#endif
 
-    if (fin)
-      fclose(fin);
+    std::sort(current_files.begin(), current_files.end(),
+              [](const ScannedFile& a, const ScannedFile& b) {
+                return a.path < b.path;
+              });
+    for (ScannedFile& file : current_files)
+      files->push_back(std::move(file));
+    // Depth first, in name order.
+    std::sort(subdirs.rbegin(), subdirs.rend(),
+              [](const PendingDirectory& a, const PendingDirectory& b) {
+                return a.path < b.path;
+              });
+    for (PendingDirectory& subdir : subdirs)
+      pending.push_back(std::move(subdir));
+  }
+  return ZIP_OK;
+}
 
-    *result_crc = calculate_crc;
-    return err;
+const size_t kDefaultMaxBytesInFlight = 64 * 1024 * 1024;
+
+struct ZipEntry {
+  std::string path;
+  std::string name_in_zip;
+  // The size from the directory scan.
+  ZPOS64_T size = 0;
+  // The content of entries archived from memory instead of |path|.
+  const char* source = nullptr;
+  // In update mode, the entry of the same name in the previous archive.
+  bool has_previous = false;
+  unz64_file_pos previous_pos;
+  unz_file_info64 previous_info;
+  // Whether the previous entry is copied as is instead of compressing.
+  bool copy_raw = false;
+  // The level chosen from the content, -1 until the first block is seen.
+  int level = -1;
+  zip_fileinfo info;
+  unsigned long crc = 0;
+  ZPOS64_T uncompressed_size = 0;
+  ZPOS64_T compressed_size = 0;
+  // The compressed data up to the entry's share of the memory budget, the
+  // rest goes to |spill_path|.
+  std::string data;
+  std::string spill_path;
+  FILE* spill = nullptr;
+  bool done = false;
+  int err = ZIP_OK;
+};
+
+struct ZipJob {
+  std::vector<ZipEntry> entries;
+  // The archive being updated, only used by the writer.
+  unzFile previous = nullptr;
+  int compression_level;
+  bool store_incompressible = true;
+  bool adaptive_levels = false;
+  size_t max_bytes_in_flight;
+  size_t memory_share;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  size_t next_entry = 0;
+  size_t next_write = 0;
+  size_t bytes_reserved = 0;
+  std::atomic<bool> abort{false};
+  greenworks::ArchiveProgressTracker* progress = nullptr;
+};
+
+int AppendCompressed(ZipEntry* entry, const char* data, size_t size,
+                     size_t memory_share) {
+  entry->compressed_size += size;
+  // Archives built in memory never spill.
+  if (!entry->spill && (entry->spill_path.empty() ||
+                        entry->data.size() + size <= memory_share)) {
+    entry->data.append(data, size);
+    return ZIP_OK;
+  }
+  if (!entry->spill) {
+    entry->spill = fopen64(entry->spill_path.c_str(), "w+b");
+    if (entry->spill == nullptr)
+      return ZIP_ERRNO;
+  }
+  return fwrite(data, 1, size, entry->spill) == size ? ZIP_OK : ZIP_ERRNO;
 }
 
-int isLargeFile(const char* filename) {
-  int largeFile = 0;
-  ZPOS64_T pos = 0;
-  FILE* pFile = fopen64(filename, "rb");
+// Formats that are already compressed, stored as is.
+const char* const kIncompressibleExtensions[] = {
+  "7z", "aac", "avi", "bik", "bk2", "br", "bz2", "flac", "gif", "gz", "jar",
+  "jpeg", "jpg", "ktx2", "lz4", "m4a", "mkv", "mov", "mp3", "mp4", "ogg",
+  "ogv", "opus", "png", "rar", "webm", "webp", "woff", "woff2", "xz", "zip",
+  "zst",
+};
+
+// Text formats, which compress well enough to be worth the best level.
+const char* const kTextExtensions[] = {
+  "cfg", "csv", "css", "frag", "glsl", "hlsl", "html", "ini", "js", "json",
+  "lua", "md", "obj", "shader", "svg", "txt", "vert", "xml", "yaml", "yml",
+};
+
+// Samples smaller than this say little about the content.
+const size_t kMinEntropySample = 4096;
+// Order-0 entropy in bits per byte above which deflate can't gain anything
+// worth its time. Compressed and encrypted data is at ~7.99, text at 4-5.
+const double kIncompressibleEntropy = 7.5;
+
+bool HasExtension(const std::string& name, const char* const* extensions,
+                  size_t count) {
+  size_t dot = name.find_last_of("./\\");
+  if (dot == std::string::npos || name[dot] != '.')
+    return false;
+  std::string extension = name.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return (char)tolower(c); });
+  for (size_t i = 0; i < count; ++i) {
+    if (extension == extensions[i])
+      return true;
+  }
+  return false;
+}
 
-  if (pFile != nullptr) {
-    fseeko64(pFile, 0, SEEK_END);
-    pos = ftello64(pFile);
+double SampleEntropy(const char* data, size_t size) {
+  size_t counts[256] = {0};
+  for (size_t i = 0; i < size; ++i)
+    ++counts[(unsigned char)data[i]];
+  double entropy = 0;
+  for (size_t count : counts) {
+    if (count == 0)
+      continue;
+    double p = (double)count / size;
+    entropy -= p * log2(p);
+  }
+  return entropy;
+}
 
-    if (pos >= 0xffffffff)
-      largeFile = 1;
+// Picks the entry's level from its name and the first block of its content.
+int ChooseLevel(const ZipEntry& entry, const ZipJob& job, const char* data,
+                size_t size) {
+  if (job.compression_level == 0)
+    return 0;
+  if (job.store_incompressible) {
+    if (HasExtension(entry.name_in_zip, kIncompressibleExtensions,
+                     sizeof(kIncompressibleExtensions) / sizeof(kIncompressibleExtensions[0])))
+      return 0;
+    if (size >= kMinEntropySample &&
+        SampleEntropy(data, size) > kIncompressibleEntropy)
+      return 0;
+  }
+  if (job.adaptive_levels &&
+      HasExtension(entry.name_in_zip, kTextExtensions,
+                   sizeof(kTextExtensions) / sizeof(kTextExtensions[0])))
+    return 9;
+  return job.compression_level;
+}
 
-    fclose(pFile);
+// Feeds |size| bytes to the entry's CRC and deflate stream. |flush| is
+// Z_FINISH for the last block of the file. The first block decides the
+// entry's level.
+int DeflateBlock(ZipEntry* entry, z_stream* stream, ZipJob* job,
+                 const char* data, size_t size, int flush) {
+  if (job->progress->cancelled())
+    return greenworks::kArchiveCancelled;
+  job->progress->AddBytes(size);
+  if (entry->level < 0) {
+    entry->level = ChooseLevel(*entry, *job, data, size);
+    if (entry->level != 0 &&
+        deflateInit2(stream, entry->level, Z_DEFLATED, -MAX_WBITS,
+                     DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK)
+      return ZIP_INTERNALERROR;
   }
 
-  return largeFile;
+  entry->crc = crc32(entry->crc, (const Bytef*)data, (uInt)size);
+  entry->uncompressed_size += size;
+  if (entry->level == 0)
+    return AppendCompressed(entry, data, size, job->memory_share);
+
+  char out[WRITEBUFFERSIZE];
+  int err = ZIP_OK;
+  stream->next_in = (Bytef*)data;
+  stream->avail_in = (uInt)size;
+  do {
+    stream->next_out = (Bytef*)out;
+    stream->avail_out = (uInt)sizeof(out);
+    deflate(stream, flush);
+    err = AppendCompressed(entry, out, sizeof(out) - stream->avail_out,
+                           job->memory_share);
+  } while (err == ZIP_OK && stream->avail_out == 0);
+  return err;
 }
 
-std::string PathCombine(std::string path1, std::string path2) {
-  char path[PATH_MAX];
+int DeflateMemory(ZipEntry* entry, z_stream* stream, ZipJob* job,
+                  const char* data, size_t size) {
+  int err = ZIP_OK;
+  size_t pos = 0;
+  do {
+    size_t block = size - pos < WRITEBUFFERSIZE ? size - pos : WRITEBUFFERSIZE;
+    int flush = pos + block == size ? Z_FINISH : Z_NO_FLUSH;
+    err = DeflateBlock(entry, stream, job, data + pos, block, flush);
+    pos += block;
+  } while (err == ZIP_OK && pos < size && !job->abort);
+  return err;
+}
 
-  strcpy(path, path1.c_str());
 #ifdef _WIN32
-  strcat(path, "\\\\");
+int DeflateFile(ZipEntry* entry, z_stream* stream, ZipJob* job) {
+  FILE* fin = fopen64(entry->path.c_str(), "rb");
+  if (fin == nullptr)
+    return ZIP_ERRNO;
+
+  std::vector<char> in(WRITEBUFFERSIZE);
+  int err = ZIP_OK;
+  int flush = Z_NO_FLUSH;
+  do {
+    size_t size_read = fread(in.data(), 1, in.size(), fin);
+    if (size_read < in.size() && ferror(fin)) {
+      err = ZIP_ERRNO;
+      break;
+    }
+    flush = feof(fin) ? Z_FINISH : Z_NO_FLUSH;
+    err = DeflateBlock(entry, stream, job, in.data(), size_read, flush);
+  } while (err == ZIP_OK && flush != Z_FINISH && !job->abort);
+  fclose(fin);
+  return err;
+}
 #else
-  strcat(path, "/");
-#endif
-  strcat(path, path2.c_str());
+// Files up to this size are read with a single read(), larger ones are
+// mapped and deflated straight from the page cache.
+const size_t kMapThreshold = 1024 * 1024;
 
-  //puts(path);
+// Reads the file once, using the size from the directory scan.
+int DeflateFile(ZipEntry* entry, z_stream* stream, ZipJob* job) {
+  int fd = open(entry->path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return ZIP_ERRNO;
 
-  return path;
+  size_t size = entry->size;
+  int err = ZIP_OK;
+  if (size <= kMapThreshold) {
+    std::vector<char> in(size);
+    size_t size_read = 0;
+    while (size_read < size) {
+      ssize_t n = read(fd, in.data() + size_read, size - size_read);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      size_read += n;
+    }
+    if (size_read == size)
+      err = DeflateMemory(entry, stream, job, in.data(), size);
+    else
+      err = ZIP_ERRNO;
+  } else {
+    // Mapping past the end of a file that shrank since the scan would fault
+    // on access, so mapped files are checked again.
+    struct stat s;
+    if (fstat(fd, &s) != 0 || (size_t)s.st_size != size) {
+      close(fd);
+      return ZIP_ERRNO;
+    }
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      madvise(data, size, MADV_SEQUENTIAL);
+      err = DeflateMemory(entry, stream, job, (const char*)data, size);
+      munmap(data, size);
+    } else {
+      err = ZIP_ERRNO;
+    }
+  }
+  close(fd);
+  return err;
 }
+#endif
 
-std::vector<std::string> GetDirectoryList(const std::string& dir)
-{
-  DIR * d;
-  std::vector<std::string> ret;
+// The same as minizip's zip64local_TmzDateToDosDate, to compare with the
+// times of a previous archive.
+uLong TmzDateToDosDate(const tm_zip& tmzip) {
+  uLong year = (uLong)tmzip.tm_year;
+  if (year >= 1980)
+    year -= 1980;
+  else if (year >= 80)
+    year -= 80;
+  return (uLong)(((tmzip.tm_mday) + (32 * (tmzip.tm_mon + 1)) + (512 * year)) << 16) |
+      ((tmzip.tm_sec / 2) + (32 * tmzip.tm_min) + (2048 * (uLong)tmzip.tm_hour));
+}
 
-  /* Open the directory specified by "dir_name". */
-  d = opendir(dir.c_str());
+int GetFileCrc(const std::string& path, unsigned long* result_crc) {
+  FILE* fin = fopen64(path.c_str(), "rb");
+  if (fin == nullptr)
+    return ZIP_ERRNO;
+  std::vector<char> buf(WRITEBUFFERSIZE);
+  unsigned long crc = 0;
+  size_t size_read;
+  while ((size_read = fread(buf.data(), 1, buf.size(), fin)) > 0)
+    crc = crc32(crc, (const Bytef*)buf.data(), (uInt)size_read);
+  int err = ferror(fin) ? ZIP_ERRNO : ZIP_OK;
+  fclose(fin);
+  *result_crc = crc;
+  return err;
+}
 
-  /* Check it was opened. */
-  if (!d) {
-    // fprintf(stderr, "Cannot open directory '%s': %s\n", dir, strerror(errno));
-    exit(EXIT_FAILURE);
+// Decides whether an entry of the previous archive can be kept: the file has
+// the same size and either the same time, or, if it was only touched, the
+// same CRC. Computing the CRC is much cheaper than deflating.
+int CheckPrevious(ZipEntry* entry) {
+  if (entry->size != entry->previous_info.uncompressed_size)
+    return ZIP_OK;
+  if (TmzDateToDosDate(entry->info.tmz_date) == entry->previous_info.dosDate) {
+    entry->copy_raw = true;
+    return ZIP_OK;
   }
+  unsigned long crc;
+  int err = GetFileCrc(entry->path, &crc);
+  if (err == ZIP_OK && crc == entry->previous_info.crc)
+    entry->copy_raw = true;
+  return err;
+}
 
-  while (1) {
-    struct dirent * entry;
-    const char * d_name;
+int CompressEntry(ZipEntry* entry, ZipJob* job) {
+  if (entry->has_previous) {
+    int err = CheckPrevious(entry);
+    if (err != ZIP_OK || entry->copy_raw)
+      return err;
+  }
 
-    /* "Readdir" gets subsequent entries from "d". */
-    entry = readdir(d);
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  int err = entry->source ?
+      DeflateMemory(entry, &stream, job, entry->source, entry->size) :
+      DeflateFile(entry, &stream, job);
+  if (stream.state != Z_NULL)
+    deflateEnd(&stream);
+  return err;
+}
 
-    if (!entry) {
-      /* There are no more entries in this directory, so break out of the while loop. */
-      break;
+void CompressEntries(ZipJob* job) {
+  while (true) {
+    size_t index;
+    {
+      std::unique_lock<std::mutex> lock(job->mutex);
+      if (job->abort || job->next_entry >= job->entries.size())
+        return;
+      index = job->next_entry++;
+      // The entry the writer waits for always goes ahead, so the budget can't
+      // stall the archive.
+      job->condition.wait(lock, [job, index] {
+        return job->abort || index == job->next_write ||
+               job->bytes_reserved + job->memory_share <=
+                   job->max_bytes_in_flight;
+      });
+      if (job->abort)
+        return;
+      job->bytes_reserved += job->memory_share;
     }
 
-    d_name = entry->d_name;
+    ZipEntry& entry = job->entries[index];
+    int err = CompressEntry(&entry, job);
+    {
+      std::lock_guard<std::mutex> lock(job->mutex);
+      job->bytes_reserved -= job->memory_share;
+      job->bytes_reserved += entry.data.capacity();
+      entry.err = err;
+      entry.done = true;
+    }
+    job->condition.notify_all();
+  }
+}
+
+int WriteEntry(zipFile zf, ZipEntry* entry, const char* password) {
+  int zip64 = entry->uncompressed_size >= 0xffffffff ||
+              entry->compressed_size >= 0xffffffff;
+  // Using 4 for unicode compatibility (UTF8) -- tested with chinese, does not work as expected
+  int err = zipOpenNewFileInZip4_64(zf, entry->name_in_zip.c_str(), &entry->info, nullptr, 0, nullptr, 0, nullptr, (entry->level != 0) ? Z_DEFLATED : 0, entry->level, 1, -MAX_WBITS, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY, password, entry->crc, 36, 1 << 11, zip64);
+  if (err != ZIP_OK)
+    return err;
+
+  for (size_t pos = 0; err == ZIP_OK && pos < entry->data.size();
+       pos += WRITEBUFFERSIZE) {
+    size_t size = entry->data.size() - pos;
+    if (size > WRITEBUFFERSIZE)
+      size = WRITEBUFFERSIZE;
+    err = zipWriteInFileInZip(zf, entry->data.data() + pos, (unsigned)size);
+  }
+  if (err == ZIP_OK && entry->spill) {
+    std::vector<char> buf(WRITEBUFFERSIZE);
+    rewind(entry->spill);
+    size_t size_read;
+    while (err == ZIP_OK &&
+           (size_read = fread(buf.data(), 1, buf.size(), entry->spill)) > 0) {
+      err = zipWriteInFileInZip(zf, buf.data(), (unsigned)size_read);
+    }
+    if (err == ZIP_OK && ferror(entry->spill))
+      err = ZIP_ERRNO;
+  }
+  if (err != ZIP_OK)
+    return err;
+  return zipCloseFileInZipRaw64(zf, entry->uncompressed_size, entry->crc);
+}
 
-    /* See if "entry" is a subdirectory of "d". */
-    if (entry->d_type & DT_DIR) {
+// Copies the compressed data of an unchanged entry from the previous archive,
+// without inflating it. Its time is updated to the file's.
+int CopyPreviousEntry(zipFile zf, unzFile previous, ZipEntry* entry) {
+  int err = unzGoToFilePos64(previous, &entry->previous_pos);
+  int method = 0;
+  int level = 0;
+  if (err == UNZ_OK)
+    err = unzOpenCurrentFile2(previous, &method, &level, 1);
+  if (err != UNZ_OK)
+    return ZIP_ERRNO;
+
+  const unz_file_info64& info = entry->previous_info;
+  int zip64 = info.uncompressed_size >= 0xffffffff ||
+              info.compressed_size >= 0xffffffff;
+  err = zipOpenNewFileInZip4_64(zf, entry->name_in_zip.c_str(), &entry->info, nullptr, 0, nullptr, 0, nullptr, method, level, 1, -MAX_WBITS, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY, nullptr, 0, 36, 1 << 11, zip64);
+  if (err == ZIP_OK) {
+    std::vector<char> buf(WRITEBUFFERSIZE);
+    int size_read;
+    while ((size_read = unzReadCurrentFile(previous, buf.data(), (unsigned)buf.size())) > 0) {
+      err = zipWriteInFileInZip(zf, buf.data(), size_read);
+      if (err != ZIP_OK)
+        break;
+    }
+    if (size_read < 0)
+      err = ZIP_ERRNO;
+    if (err == ZIP_OK)
+      err = zipCloseFileInZipRaw64(zf, info.uncompressed_size, info.crc);
+  }
+  unzCloseCurrentFile(previous);
+  return err;
+}
 
-      /* Check that the directory is not "d" or d's parent. */
-      if (strcmp(d_name, "..") != 0 && strcmp(d_name, ".") != 0) {
-        int path_length;
-        char path[PATH_MAX];
+// Frees the entry's buffered data, returning how much memory it held.
+size_t ReleaseEntry(ZipEntry* entry) {
+  size_t capacity = entry->data.capacity();
+  std::string().swap(entry->data);
+  if (entry->spill) {
+    fclose(entry->spill);
+    entry->spill = nullptr;
+    remove(entry->spill_path.c_str());
+  }
+  return capacity;
+}
 
-        strcpy(path, dir.c_str());
-#ifdef WIN32
-        strcat(path, "\\\\");
+unzFile OpenPreviousArchive(const char* path) {
+#ifdef USEWIN32IOAPI
+  zlib_filefunc64_def ffunc;
+  fill_win32_filefunc64A(&ffunc);
+  return unzOpen2_64(path, &ffunc);
 #else
-        strcat(path, "/");
+  return unzOpen64(path);
 #endif
-        strcat(path, d_name);
+}
 
-        //puts(path);
+// Matches the entries to the previous archive's by name. Encrypted entries
+// and entries of a password protected update are always compressed again.
+int FindPreviousEntries(unzFile previous, const char* password,
+                        std::vector<ZipEntry>* entries) {
+  std::unordered_map<std::string, ZipEntry*> by_name;
+  for (ZipEntry& entry : *entries)
+    by_name[entry.name_in_zip] = &entry;
+
+  int err = unzGoToFirstFile(previous);
+  while (err == UNZ_OK) {
+    unz_file_info64 info;
+    err = unzGetCurrentFileInfo64(previous, &info, nullptr, 0, nullptr, 0,
+                                  nullptr, 0);
+    if (err != UNZ_OK)
+      break;
+    std::string name(info.size_filename, '\0');
+    err = unzGetCurrentFileInfo64(previous, nullptr, &name[0],
+                                  info.size_filename + 1, nullptr, 0, nullptr,
+                                  0);
+    if (err != UNZ_OK)
+      break;
+    auto found = by_name.find(name);
+    if (found != by_name.end() && password == nullptr && !(info.flag & 1)) {
+      ZipEntry* entry = found->second;
+      entry->has_previous = true;
+      entry->previous_info = info;
+      err = unzGetFilePos64(previous, &entry->previous_pos);
+      if (err != UNZ_OK)
+        break;
+    }
+    err = unzGoToNextFile(previous);
+  }
+  return err == UNZ_END_OF_LIST_OF_FILE ? ZIP_OK : ZIP_ERRNO;
+}
 
-        path_length = strlen(path);
+// Compresses the job's entries on the worker threads while this thread adds
+// them to |zf| in order.
+int WriteArchive(zipFile zf, ZipJob* job,
+                 const greenworks::ZipOptions& options) {
+  if (job->entries.empty())
+    return ZIP_OK;
+  const char* password = (options.password != nullptr && strlen(options.password) > 0) ? options.password : nullptr;
+
+  size_t num_threads = options.num_threads > 0 ? options.num_threads : std::thread::hardware_concurrency();
+  if (num_threads == 0)
+    num_threads = 1;
+  if (num_threads > job->entries.size())
+    num_threads = job->entries.size();
+  job->memory_share = job->max_bytes_in_flight / num_threads;
+  if (job->memory_share < WRITEBUFFERSIZE)
+    job->memory_share = WRITEBUFFERSIZE;
+
+  greenworks::ArchiveProgressTracker progress(options.progress,
+                                              options.cancel);
+  uint64_t total_bytes = 0;
+  for (const ZipEntry& entry : job->entries)
+    total_bytes += entry.size;
+  progress.SetTotals(total_bytes, job->entries.size());
+  job->progress = &progress;
+
+  std::vector<std::thread> threads;
+  for (size_t index = 0; index < num_threads; ++index)
+    threads.emplace_back(CompressEntries, job);
 
-        if (path_length >= PATH_MAX) {
-          fprintf(stderr, "Path length has got too long.\n");
-          exit(EXIT_FAILURE);
-        }
-        std::vector<std::string> rret = GetDirectoryList(path);
-        ret.insert(ret.end(), rret.begin(), rret.end());
-      }
+  int err = ZIP_OK;
+  for (size_t index = 0; index < job->entries.size() && err == ZIP_OK; ++index) {
+    ZipEntry& entry = job->entries[index];
+    {
+      std::unique_lock<std::mutex> lock(job->mutex);
+      job->condition.wait(lock, [&entry] { return entry.done; });
     }
-    else {
-      ret.push_back(PathCombine(dir, entry->d_name));
+    err = entry.err;
+    if (err == ZIP_OK && progress.cancelled())
+      err = greenworks::kArchiveCancelled;
+    if (err == ZIP_OK && entry.copy_raw) {
+      err = CopyPreviousEntry(zf, job->previous, &entry);
+      progress.AddBytes(entry.size);
+    } else if (err == ZIP_OK) {
+      err = WriteEntry(zf, &entry, password);
     }
+    if (err == ZIP_OK)
+      progress.AddEntry();
+    size_t released = ReleaseEntry(&entry);
+    {
+      std::lock_guard<std::mutex> lock(job->mutex);
+      job->bytes_reserved -= released;
+      job->next_write = index + 1;
+    }
+    job->condition.notify_all();
   }
-  /* After going through all the entries, close the directory. */
-  if (closedir(d)) {
-    // fprintf(stderr, "Could not close '%s': %s\n", dir, strerror(errno));
-    exit(EXIT_FAILURE);
+
+  if (err != ZIP_OK) {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    job->abort = true;
   }
+  job->condition.notify_all();
+  for (std::thread& thread : threads)
+    thread.join();
+  for (ZipEntry& entry : job->entries)
+    ReleaseEntry(&entry);
 
-  return ret;
+  if (err == ZIP_OK)
+    progress.Finish();
+  job->progress = nullptr;
+  return err;
 }
 
 }
@@ -277,123 +826,150 @@ std::vector<std::string> GetDirectoryList(const std::string& dir)
 namespace greenworks {
 
 int zip(const char* targetFile, const char* sourceDir, int compressionLevel, const char* password) {
-  // compressionLevel 0-9 (store only - best)
+  ZipOptions options;
+  options.compression_level = compressionLevel;
+  options.password = password;
+  return zip(targetFile, sourceDir, options);
+}
+
+int zip(const char* targetFile, const char* sourceDir, const ZipOptions& options) {
   int opt_overwrite = 1;// Overwrite existing zip file
-  int opt_compress_level = compressionLevel;
-  char filename_try[MAXFILENAME + 16];
   int err = 0;
-  int size_buf = 0;
-  void* buf = nullptr;
-  int i, len;
-  int dot_found = 0;
-
-  size_buf = WRITEBUFFERSIZE;
-  buf = (void*)malloc(size_buf);
-  if (buf == nullptr)
-    return ZIP_INTERNALERROR;
-
-  strncpy(filename_try, targetFile, MAXFILENAME - 1);
-  // strncpy doesnt append the trailing NULL, of the string is too long.
-  filename_try[MAXFILENAME] = '\0';
-
-  len = (int)strlen(filename_try);
-  for (i = 0; i < len; i++) {
-    if (filename_try[i] == '.')
-      dot_found = 1;
-  }
 
-  if (dot_found == 0) {
-    strcat(filename_try, ".zip");
-  }
+  std::string filename_try = targetFile;
+  if (filename_try.find('.') == std::string::npos)
+    filename_try += ".zip";
+
+  std::vector<ScannedFile> files;
+  err = ScanDirectory(sourceDir, &files);
+  if (err == ZIP_OK && files.size() <= 0)
+    err = ZIP_PARAMERROR;
+  if (err != ZIP_OK)
+    return err;
+
+  // An update writes the new archive next to the previous one, which it reads
+  // from, and replaces it once complete.
+  unzFile previous = options.update ? OpenPreviousArchive(filename_try.c_str()) : nullptr;
+  std::string output = filename_try;
+  if (previous)
+    output += ".new";
 
   zipFile zf;
 
 #ifdef USEWIN32IOAPI
   zlib_filefunc64_def ffunc;
   fill_win32_filefunc64A(&ffunc);
-  zf = zipOpen2_64(filename_try, (opt_overwrite == 2) ? 2 : 0, NULL, &ffunc);
+  zf = zipOpen2_64(output.c_str(), (opt_overwrite == 2) ? 2 : 0, NULL, &ffunc);
 #else
-  zf = zipOpen64(filename_try, (opt_overwrite == 2) ? 2 : 0);
+  zf = zipOpen64(output.c_str(), (opt_overwrite == 2) ? 2 : 0);
 #endif
 
-  if (zf == nullptr)
-    err = ZIP_ERRNO;
-
-  std::vector<std::string> files = GetDirectoryList(sourceDir);
-  if (files.size() <= 0) {
-    err = ZIP_PARAMERROR;
-  } else {
-    std::vector<std::string>::iterator itr;
-    for (itr = files.begin(); itr < files.end(); ++itr) {
-      const char* filenameinzip = itr->c_str();
-      const char *savefilenameinzip;
-
-      FILE * fin;
-      int size_read;
-      zip_fileinfo zi;
-      unsigned long crcFile = 0;
-      int zip64 = 0;
-
-      zi.tmz_date.tm_sec = zi.tmz_date.tm_min = zi.tmz_date.tm_hour = zi.tmz_date.tm_mday = zi.tmz_date.tm_mon = zi.tmz_date.tm_year = 0;
-      zi.dosDate = 0;
-      zi.internal_fa = 0;
-      zi.external_fa = 0;
-
-      filetime(filenameinzip, &zi.tmz_date, &zi.dosDate);
+  if (zf == nullptr) {
+    if (previous)
+      unzClose(previous);
+    return ZIP_ERRNO;
+  }
 
-      if ((password != nullptr && strlen(password) > 0) && (err == ZIP_OK))
-        err = getFileCrc(filenameinzip, buf, size_buf, &crcFile);
+  ZipJob job;
+  job.compression_level = options.compression_level;
+  job.store_incompressible = options.store_incompressible;
+  job.adaptive_levels = options.adaptive_levels;
+  job.max_bytes_in_flight = options.max_bytes_in_flight > 0 ? options.max_bytes_in_flight : kDefaultMaxBytesInFlight;
+  job.entries.resize(files.size());
+  for (size_t index = 0; index < files.size(); ++index) {
+    ZipEntry& entry = job.entries[index];
+    entry.path = files[index].path;
+    entry.size = files[index].size;
+    memset(&entry.info, 0, sizeof(entry.info));
+    filetime(files[index].mtime, &entry.info.tmz_date);
+    entry.spill_path = filename_try + "." + std::to_string(index) + ".tmp";
+
+    // The path name saved, should not include a leading slash.
+    // if it did, windows/xp and dynazip couldn't read the zip file.
+    std::string baseDir = entry.path.substr(std::string(sourceDir).rfind(kPathSeparator) + 1);
+    size_t name_start = baseDir.find_first_not_of("\\/");
+    entry.name_in_zip = name_start == std::string::npos ? std::string() : baseDir.substr(name_start);
+  }
 
-      zip64 = isLargeFile(filenameinzip);
+  const char* password = (options.password != nullptr && strlen(options.password) > 0) ? options.password : nullptr;
+  job.previous = previous;
+  if (previous)
+    err = FindPreviousEntries(previous, password, &job.entries);
 
-      // The path name saved, should not include a leading slash.
-      // if it did, windows/xp and dynazip couldn't read the zip file.
-#ifdef WIN32
-      std::string baseDir = itr->substr(std::string(sourceDir).rfind('\\') + 1);
-#else
-      std::string baseDir = itr->substr(std::string(sourceDir).rfind('/') + 1);
+  if (err == ZIP_OK)
+    err = WriteArchive(zf, &job, options);
+  if (err < 0 && err != kArchiveCancelled)
+    err = ZIP_ERRNO;
+  int close_err = zipClose(zf, nullptr);
+  if (err == ZIP_OK)
+    err = close_err;
+  // A cancelled update only removes its ".new" output, below.
+  if (err == kArchiveCancelled && !previous)
+    remove(filename_try.c_str());
+
+  if (previous) {
+    unzClose(previous);
+    if (err == ZIP_OK) {
+#ifdef _WIN32
+      remove(filename_try.c_str());
 #endif
-
-      savefilenameinzip = baseDir.c_str();
-
-      while (savefilenameinzip[0] == '\\' || savefilenameinzip[0] == '/')
-        savefilenameinzip++;
-
-      // Using 4 for unicode compatibility (UTF8) -- tested with chinese, does not work as expected
-      err = zipOpenNewFileInZip4_64(zf, savefilenameinzip, &zi, nullptr, 0, nullptr, 0, nullptr, (opt_compress_level != 0) ? Z_DEFLATED : 0, opt_compress_level, 0, -MAX_WBITS, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY, password, crcFile, 36, 1 << 11, zip64);
-
-      if (err != ZIP_OK)
-        break;
-
-      fin = fopen64(filenameinzip, "rb");
-      if (fin == nullptr)
+      if (rename(output.c_str(), filename_try.c_str()) != 0)
         err = ZIP_ERRNO;
-
-      if (err == ZIP_OK) {
-        do {
-          err = ZIP_OK;
-          size_read = (int)fread(buf, 1, size_buf, fin);
-          if (size_read < size_buf)
-            if (feof(fin) == 0)
-              err = ZIP_ERRNO;
-
-          if (size_read>0) {
-            err = zipWriteInFileInZip(zf, buf, size_read);
-          }
-        } while ((err == ZIP_OK) && (size_read>0));
-      }
-      if (fin)
-        fclose(fin);
-      if (err < 0)
-        err = ZIP_ERRNO;
-      else
-        err = zipCloseFileInZip(zf);
     }
+    if (err != ZIP_OK)
+      remove(output.c_str());
   }
-  zipClose(zf, nullptr);
-  free(buf);
   return err;
 }
 
-}  // namespace greenworks
+int zipToMemory(const std::vector<ZipMemoryEntry>& entries,
+                const ZipOptions& options, char** archive,
+                size_t* archive_size) {
+  MemoryArchive memory;
+  memory.writable = true;
+  zlib_filefunc64_def ffunc;
+  FillMemoryFileFunc(&ffunc, &memory);
+  zipFile zf = zipOpen2_64("", 0, nullptr, &ffunc);
+  if (zf == nullptr)
+    return ZIP_ERRNO;
+
+  tm_zip now;
+  filetime(time(nullptr), &now);
+
+  ZipJob job;
+  job.compression_level = options.compression_level;
+  job.store_incompressible = options.store_incompressible;
+  job.adaptive_levels = options.adaptive_levels;
+  job.max_bytes_in_flight = options.max_bytes_in_flight > 0 ? options.max_bytes_in_flight : kDefaultMaxBytesInFlight;
+  job.entries.resize(entries.size());
+  for (size_t index = 0; index < entries.size(); ++index) {
+    ZipEntry& entry = job.entries[index];
+    size_t name_start = entries[index].name.find_first_not_of("\\/");
+    if (name_start == std::string::npos) {
+      zipClose(zf, nullptr);
+      free(memory.data);
+      return ZIP_PARAMERROR;
+    }
+    entry.name_in_zip = entries[index].name.substr(name_start);
+    entry.source = entries[index].data;
+    entry.size = entries[index].size;
+    memset(&entry.info, 0, sizeof(entry.info));
+    entry.info.tmz_date = now;
+  }
+
+  int err = WriteArchive(zf, &job, options);
+  int close_err = zipClose(zf, nullptr);
+  if (err == ZIP_OK)
+    err = close_err;
+  if (err == ZIP_OK && memory.error)
+    err = ZIP_ERRNO;
+  if (err != ZIP_OK) {
+    free(memory.data);
+    return err < 0 ? err : ZIP_ERRNO;
+  }
+  *archive = memory.data;
+  *archive_size = memory.size;
+  return ZIP_OK;
+}
 
+}  // namespace greenworks
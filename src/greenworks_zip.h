@@ -19,10 +19,62 @@
 #ifndef GREENWORKS_ZIP_H_
 #define GREENWORKS_ZIP_H_
 
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "greenworks_archive_progress.h"
+
 namespace greenworks {
 
+struct ZipOptions {
+  // Compress factor 0-9, store only - best compressed.
+  int compression_level = 6;
+  // nullptr or empty for no password.
+  const char* password = nullptr;
+  // The number of compressing threads, 0 for one per core.
+  int num_threads = 0;
+  // The compressed data buffered ahead of the archive writer. Entries beyond
+  // their share of it are spilled to temporary files next to the archive.
+  // 0 for the default.
+  size_t max_bytes_in_flight = 0;
+  // Stores files that won't compress, found by extension (png, ogg, zip...)
+  // or by the entropy of their first block, without deflating them.
+  bool store_incompressible = true;
+  // Compresses text formats (json, lua, xml...) at the best level, whatever
+  // |compression_level| is.
+  bool adaptive_levels = false;
+  // Updates an existing archive at the target path: entries whose file has
+  // the same size and time, or the same size and CRC, are copied from it
+  // without recompressing. Only used by zip().
+  bool update = false;
+  // Called with the job's progress from its threads, see
+  // ArchiveProgressTracker.
+  ArchiveProgressCallback progress;
+  // Stops the job once set, between blocks. The job then fails with
+  // kArchiveCancelled after removing what it wrote.
+  const std::atomic<bool>* cancel = nullptr;
+};
+
 int zip(const char* targetFile, const char* sourceDir, int compressionLevel, const char* password);
 
+// Compresses the entries on |options.num_threads| threads, while the calling
+// thread writes them to the archive in order.
+int zip(const char* targetFile, const char* sourceDir, const ZipOptions& options);
+
+struct ZipMemoryEntry {
+  std::string name;
+  // Not owned, must outlive the zipToMemory call.
+  const char* data;
+  size_t size;
+};
+
+// Archives |entries| without touching the disk. On success |archive| holds a
+// malloc'd buffer of |archive_size| bytes that the caller frees.
+int zipToMemory(const std::vector<ZipMemoryEntry>& entries,
+                const ZipOptions& options, char** archive,
+                size_t* archive_size);
+
 }
 
 #endif  // GREENWORKS_ZIP_H_
@@ -0,0 +1,116 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "greenworks_zip_memory.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace greenworks {
+
+namespace {
+
+struct MemoryStream {
+  MemoryArchive* archive;
+  ZPOS64_T position;
+};
+
+voidpf ZCALLBACK OpenMemory(voidpf opaque, const void* filename, int mode) {
+  MemoryArchive* archive = static_cast<MemoryArchive*>(opaque);
+  if ((mode & ZLIB_FILEFUNC_MODE_WRITE) && !archive->writable)
+    return nullptr;
+  return new MemoryStream{archive, 0};
+}
+
+uLong ZCALLBACK ReadMemory(voidpf opaque, voidpf stream, void* buf,
+                           uLong size) {
+  MemoryStream* memory = static_cast<MemoryStream*>(stream);
+  MemoryArchive* archive = memory->archive;
+  if (memory->position >= archive->size)
+    return 0;
+  if (size > archive->size - memory->position)
+    size = static_cast<uLong>(archive->size - memory->position);
+  memcpy(buf, archive->data + memory->position, size);
+  memory->position += size;
+  return size;
+}
+
+uLong ZCALLBACK WriteMemory(voidpf opaque, voidpf stream, const void* buf,
+                            uLong size) {
+  MemoryStream* memory = static_cast<MemoryStream*>(stream);
+  MemoryArchive* archive = memory->archive;
+  size_t end = memory->position + size;
+  if (end > archive->capacity) {
+    size_t capacity = archive->capacity ? archive->capacity : 64 * 1024;
+    while (capacity < end)
+      capacity *= 2;
+    char* data = static_cast<char*>(realloc(archive->data, capacity));
+    if (data == nullptr) {
+      archive->error = true;
+      return 0;
+    }
+    archive->data = data;
+    archive->capacity = capacity;
+  }
+  // minizip seeks back to patch local headers, so writes aren't always
+  // appends.
+  if (memory->position > archive->size)
+    memset(archive->data + archive->size, 0, memory->position - archive->size);
+  memcpy(archive->data + memory->position, buf, size);
+  memory->position = end;
+  if (end > archive->size)
+    archive->size = end;
+  return size;
+}
+
+ZPOS64_T ZCALLBACK TellMemory(voidpf opaque, voidpf stream) {
+  return static_cast<MemoryStream*>(stream)->position;
+}
+
+long ZCALLBACK SeekMemory(voidpf opaque, voidpf stream, ZPOS64_T offset,
+                          int origin) {
+  MemoryStream* memory = static_cast<MemoryStream*>(stream);
+  ZPOS64_T base = 0;
+  switch (origin) {
+    case ZLIB_FILEFUNC_SEEK_SET:
+      break;
+    case ZLIB_FILEFUNC_SEEK_CUR:
+      base = memory->position;
+      break;
+    case ZLIB_FILEFUNC_SEEK_END:
+      base = memory->archive->size;
+      break;
+    default:
+      return -1;
+  }
+  if (base + offset > memory->archive->size && !memory->archive->writable)
+    return -1;
+  memory->position = base + offset;
+  return 0;
+}
+
+int ZCALLBACK CloseMemory(voidpf opaque, voidpf stream) {
+  delete static_cast<MemoryStream*>(stream);
+  return 0;
+}
+
+int ZCALLBACK ErrorMemory(voidpf opaque, voidpf stream) {
+  return static_cast<MemoryStream*>(stream)->archive->error ? 1 : 0;
+}
+
+}  // namespace
+
+void FillMemoryFileFunc(zlib_filefunc64_def* filefunc,
+                        MemoryArchive* archive) {
+  filefunc->zopen64_file = OpenMemory;
+  filefunc->zread_file = ReadMemory;
+  filefunc->zwrite_file = WriteMemory;
+  filefunc->ztell64_file = TellMemory;
+  filefunc->zseek64_file = SeekMemory;
+  filefunc->zclose_file = CloseMemory;
+  filefunc->zerror_file = ErrorMemory;
+  filefunc->opaque = archive;
+}
+
+}  // namespace greenworks
@@ -0,0 +1,30 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#ifndef SRC_GREENWORKS_ZIP_MEMORY_H_
+#define SRC_GREENWORKS_ZIP_MEMORY_H_
+
+#include <cstddef>
+
+#include "zlib/contrib/minizip/ioapi.h"
+
+namespace greenworks {
+
+// An archive kept in memory, read or written by minizip through the I/O hooks
+// of FillMemoryFileFunc. Each zipOpen2_64/unzOpen2_64 gets its own position,
+// so several threads can read the same archive at once.
+struct MemoryArchive {
+  // Growable malloc'd storage when writing, the caller's data when reading.
+  char* data = nullptr;
+  size_t size = 0;
+  size_t capacity = 0;
+  bool writable = false;
+  bool error = false;
+};
+
+void FillMemoryFileFunc(zlib_filefunc64_def* filefunc, MemoryArchive* archive);
+
+}  // namespace greenworks
+
+#endif  // SRC_GREENWORKS_ZIP_MEMORY_H_
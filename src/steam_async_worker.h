@@ -23,6 +23,39 @@ class SteamAsyncWorker : public Nan::AsyncWorker {
   Nan::Callback* error_callback_;
 };
 
+// A SteamAsyncWorker which can report progress of type T while executing.
+// Every progress event sent from Execute is delivered, in order, to
+// HandleProgressCallback.
+template <typename T>
+class SteamAsyncProgressWorker : public Nan::AsyncProgressQueueWorker<T> {
+ public:
+  SteamAsyncProgressWorker(Nan::Callback* success_callback,
+                           Nan::Callback* error_callback,
+                           Nan::Callback* progress_callback)
+      : Nan::AsyncProgressQueueWorker<T>(success_callback),
+        error_callback_(error_callback),
+        progress_callback_(progress_callback) {}
+
+  ~SteamAsyncProgressWorker() override {
+    delete error_callback_;
+    delete progress_callback_;
+  }
+
+  void HandleErrorCallback() override {
+    if (!error_callback_) return;
+    Nan::HandleScope scope;
+    v8::Local<v8::Value> argv[] = {
+        Nan::New(this->ErrorMessage()).ToLocalChecked() };
+    Nan::AsyncResource resource(
+        "greenworks:SteamAsyncProgressWorker.HandleErrorCallback");
+    error_callback_->Call(1, argv, &resource);
+  }
+
+ protected:
+  Nan::Callback* error_callback_;
+  Nan::Callback* progress_callback_;
+};
+
 // An abstract SteamAsyncWorker for Steam callback API.
 class SteamCallbackAsyncWorker : public SteamAsyncWorker {
  public:
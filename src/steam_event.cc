@@ -9,6 +9,8 @@
 #include "v8.h"
 
 #include "greenworks_utils.h"
+#include "steam_lobby_data_mirror.h"
+#include "steam_matchmaking_constants.h"
 
 namespace greenworks {
 
@@ -149,6 +151,50 @@ void SteamEvent::OnLobbyDataUpdate(uint64 SteamIdLobby, uint64 SteamIdMember, bo
   Nan::AsyncResource ar("greenworks:SteamEvent.OnLobbyDataUpdate");
   ar.runInAsyncScope(
       Nan::New(persistent_steam_events_), "on", 4, argv);
+
+  LobbyDataDiff diff;
+  std::map<uint64, LobbyDataDiff> departed;
+  if (!Success ||
+      !LobbyDataMirror::GetInstance()->Update(
+          CSteamID(SteamIdLobby), CSteamID(SteamIdMember), &diff,
+          &departed)) {
+    return;
+  }
+  if (!diff.empty())
+    EmitLobbyDataDiff(&ar, SteamIdLobby, SteamIdMember, diff);
+  for (const auto& member : departed)
+    EmitLobbyDataDiff(&ar, SteamIdLobby, member.first, member.second);
+}
+
+void SteamEvent::EmitLobbyDataDiff(Nan::AsyncResource* ar, uint64 lobby_id,
+                                   uint64 member_id,
+                                   const LobbyDataDiff& diff) {
+  v8::Local<v8::Object> added = Nan::New<v8::Object>();
+  for (const auto& key_value : diff.added) {
+    Nan::Set(added, Nan::New(key_value.first).ToLocalChecked(),
+             Nan::New(key_value.second).ToLocalChecked());
+  }
+  v8::Local<v8::Object> changed = Nan::New<v8::Object>();
+  for (const auto& key_value : diff.changed) {
+    Nan::Set(changed, Nan::New(key_value.first).ToLocalChecked(),
+             Nan::New(key_value.second).ToLocalChecked());
+  }
+  v8::Local<v8::Array> removed = Nan::New<v8::Array>(
+      static_cast<int>(diff.removed.size()));
+  for (uint32_t i = 0; i < diff.removed.size(); ++i)
+    Nan::Set(removed, i, Nan::New(diff.removed[i]).ToLocalChecked());
+  v8::Local<v8::Object> diff_obj = Nan::New<v8::Object>();
+  Nan::Set(diff_obj, Nan::New("added").ToLocalChecked(), added);
+  Nan::Set(diff_obj, Nan::New("changed").ToLocalChecked(), changed);
+  Nan::Set(diff_obj, Nan::New("removed").ToLocalChecked(), removed);
+
+  v8::Local<v8::Value> argv[] = {
+      Nan::New("lobby-data-diff").ToLocalChecked(),
+      Nan::New(utils::uint64ToString(lobby_id)).ToLocalChecked(),
+      Nan::New(utils::uint64ToString(member_id)).ToLocalChecked(),
+      diff_obj,
+  };
+  ar->runInAsyncScope(Nan::New(persistent_steam_events_), "on", 4, argv);
 }
 
 void SteamEvent::OnLobbyEnter(uint64 SteamIdLobby, int ChatPermissions, bool Locked, int ChatRoomEnterResponse) {
@@ -266,18 +312,38 @@ void SteamEvent::OnLobbyChatUpdate(uint64 SteamIDLobby,
       Nan::New(ChatMemberStateChange)};
   Nan::AsyncResource ar("greenworks:SteamEvent.OnLobbyChatUpdate");
   ar.runInAsyncScope(Nan::New(persistent_steam_events_), "on", 5, argv);
+
+  // Members leave without a LobbyDataUpdate_t, so drop their mirrored data
+  // here rather than on the lobby's next data update.
+  std::map<uint64, LobbyDataDiff> departed;
+  LobbyDataMirror::GetInstance()->RemoveDepartedMembers(CSteamID(SteamIDLobby),
+                                                        &departed);
+  for (const auto& member : departed)
+    EmitLobbyDataDiff(&ar, SteamIDLobby, member.first, member.second);
 }
 
 void SteamEvent::OnLobbyChatMsg(uint64 steamIDLobby, uint64 steamIDUser,
                                 uint8 chatEntryType, uint32 chatID) {
   Nan::HandleScope scope;
+  // Hand the payload to the listeners directly, so they don't each need to
+  // call getLobbyChatEntry for it.
+  char data[kMaxLobbyChatMsgSize];
+  CSteamID sender;
+  EChatEntryType entry_type;
+  int data_size = SteamMatchmaking()->GetLobbyChatEntry(
+      CSteamID(steamIDLobby), chatID, &sender, data, sizeof(data),
+      &entry_type);
+  v8::Local<v8::Value> payload = Nan::Null();
+  if (data_size >= 0)
+    payload = Nan::CopyBuffer(data, data_size).ToLocalChecked();
+
   v8::Local<v8::Value> argv[] = {
       Nan::New("lobby-chat-msg").ToLocalChecked(),
       Nan::New(utils::uint64ToString(steamIDLobby)).ToLocalChecked(),
       Nan::New(utils::uint64ToString(steamIDUser)).ToLocalChecked(),
-      Nan::New(chatEntryType), Nan::New(chatID)};
+      Nan::New(chatEntryType), Nan::New(chatID), payload};
   Nan::AsyncResource ar("greenworks:SteamEvent.OnLobbyChatMsg");
-  ar.runInAsyncScope(Nan::New(persistent_steam_events_), "on", 5, argv);
+  ar.runInAsyncScope(Nan::New(persistent_steam_events_), "on", 6, argv);
 }
 
 void SteamEvent::OnValidateAuthTicketResponse(CSteamID m_SteamID,
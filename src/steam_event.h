@@ -11,6 +11,8 @@
 
 namespace greenworks {
 
+struct LobbyDataDiff;
+
 class SteamEvent : public greenworks::SteamClient::Observer {
  public:
   explicit SteamEvent(
@@ -65,6 +67,9 @@ class SteamEvent : public greenworks::SteamClient::Observer {
       SteamNetConnectionStatusChangedCallback_t *pInfo) override;
 
 private:
+  void EmitLobbyDataDiff(Nan::AsyncResource* ar, uint64 lobby_id,
+                         uint64 member_id, const LobbyDataDiff& diff);
+
   const Nan::Persistent<v8::Object>& persistent_steam_events_;
 };
 
@@ -0,0 +1,148 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#include "steam_lobby_data_mirror.h"
+
+#include <set>
+
+namespace greenworks {
+
+LobbyDataMirror* LobbyDataMirror::GetInstance() {
+  static LobbyDataMirror lobby_data_mirror;
+  return &lobby_data_mirror;
+}
+
+void LobbyDataMirror::Watch(CSteamID lobby_id,
+                            const std::vector<std::string>& member_keys) {
+  Lobby& lobby = lobbies_[lobby_id.ConvertToUint64()];
+  lobby.member_keys = member_keys;
+  lobby.data = ReadLobbyData(lobby_id);
+  lobby.member_data.clear();
+  if (member_keys.empty())
+    return;
+  ISteamMatchmaking* steam_matchmaking = SteamMatchmaking();
+  int num_members = steam_matchmaking->GetNumLobbyMembers(lobby_id);
+  for (int i = 0; i < num_members; ++i) {
+    CSteamID member_id = steam_matchmaking->GetLobbyMemberByIndex(lobby_id, i);
+    lobby.member_data[member_id.ConvertToUint64()] =
+        ReadMemberData(lobby_id, member_id, member_keys);
+  }
+}
+
+bool LobbyDataMirror::Unwatch(CSteamID lobby_id) {
+  return lobbies_.erase(lobby_id.ConvertToUint64()) > 0;
+}
+
+bool LobbyDataMirror::Update(CSteamID lobby_id, CSteamID member_id,
+                             LobbyDataDiff* diff,
+                             std::map<uint64, LobbyDataDiff>* departed) {
+  auto it = lobbies_.find(lobby_id.ConvertToUint64());
+  if (it == lobbies_.end())
+    return false;
+  Lobby& lobby = it->second;
+  RemoveDepartedMembers(lobby_id, &lobby, departed);
+
+  if (member_id == lobby_id) {
+    KeyValues data = ReadLobbyData(lobby_id);
+    Diff(lobby.data, data, diff);
+    lobby.data.swap(data);
+    return true;
+  }
+
+  if (lobby.member_keys.empty())
+    return true;
+  KeyValues data = ReadMemberData(lobby_id, member_id, lobby.member_keys);
+  KeyValues& old_data = lobby.member_data[member_id.ConvertToUint64()];
+  Diff(old_data, data, diff);
+  if (data.empty())
+    lobby.member_data.erase(member_id.ConvertToUint64());
+  else
+    old_data.swap(data);
+  return true;
+}
+
+void LobbyDataMirror::RemoveDepartedMembers(
+    CSteamID lobby_id, std::map<uint64, LobbyDataDiff>* departed) {
+  auto it = lobbies_.find(lobby_id.ConvertToUint64());
+  if (it != lobbies_.end())
+    RemoveDepartedMembers(lobby_id, &it->second, departed);
+}
+
+void LobbyDataMirror::RemoveDepartedMembers(
+    CSteamID lobby_id, Lobby* lobby,
+    std::map<uint64, LobbyDataDiff>* departed) {
+  if (lobby->member_data.empty())
+    return;
+  ISteamMatchmaking* steam_matchmaking = SteamMatchmaking();
+  std::set<uint64> members;
+  int num_members = steam_matchmaking->GetNumLobbyMembers(lobby_id);
+  for (int i = 0; i < num_members; ++i) {
+    members.insert(
+        steam_matchmaking->GetLobbyMemberByIndex(lobby_id, i)
+            .ConvertToUint64());
+  }
+  for (auto member = lobby->member_data.begin();
+       member != lobby->member_data.end();) {
+    if (members.count(member->first)) {
+      ++member;
+      continue;
+    }
+    Diff(member->second, KeyValues(), &(*departed)[member->first]);
+    member = lobby->member_data.erase(member);
+  }
+}
+
+LobbyDataMirror::KeyValues LobbyDataMirror::ReadLobbyData(CSteamID lobby_id) {
+  ISteamMatchmaking* steam_matchmaking = SteamMatchmaking();
+  KeyValues data;
+  char key[k_nMaxLobbyKeyLength];
+  char value[k_cubChatMetadataMax];
+  int data_count = steam_matchmaking->GetLobbyDataCount(lobby_id);
+  for (int i = 0; i < data_count; ++i) {
+    if (steam_matchmaking->GetLobbyDataByIndex(lobby_id, i, key, sizeof(key),
+                                               value, sizeof(value))) {
+      data[key] = value;
+    }
+  }
+  return data;
+}
+
+LobbyDataMirror::KeyValues LobbyDataMirror::ReadMemberData(
+    CSteamID lobby_id, CSteamID member_id,
+    const std::vector<std::string>& keys) {
+  ISteamMatchmaking* steam_matchmaking = SteamMatchmaking();
+  KeyValues data;
+  for (const auto& key : keys) {
+    const char* value =
+        steam_matchmaking->GetLobbyMemberData(lobby_id, member_id, key.c_str());
+    if (value && *value)
+      data[key] = value;
+  }
+  return data;
+}
+
+void LobbyDataMirror::Diff(const KeyValues& old_values,
+                           const KeyValues& new_values,
+                           LobbyDataDiff* diff) {
+  // Both maps are sorted by key, so walk them side by side.
+  auto old_it = old_values.begin();
+  auto new_it = new_values.begin();
+  while (old_it != old_values.end() || new_it != new_values.end()) {
+    if (new_it == new_values.end() ||
+        (old_it != old_values.end() && old_it->first < new_it->first)) {
+      diff->removed.push_back(old_it->first);
+      ++old_it;
+    } else if (old_it == old_values.end() || new_it->first < old_it->first) {
+      diff->added.insert(*new_it);
+      ++new_it;
+    } else {
+      if (old_it->second != new_it->second)
+        diff->changed.insert(*new_it);
+      ++old_it;
+      ++new_it;
+    }
+  }
+}
+
+}  // namespace greenworks
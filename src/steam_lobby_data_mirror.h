@@ -0,0 +1,75 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#ifndef SRC_STEAM_LOBBY_DATA_MIRROR_H_
+#define SRC_STEAM_LOBBY_DATA_MIRROR_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "steam/steam_api.h"
+
+namespace greenworks {
+
+// The keys that changed between two versions of a lobby's (or a lobby
+// member's) data.
+struct LobbyDataDiff {
+  std::map<std::string, std::string> added;
+  std::map<std::string, std::string> changed;
+  std::vector<std::string> removed;
+
+  bool empty() const {
+    return added.empty() && changed.empty() && removed.empty();
+  }
+};
+
+// Keeps a native copy of the data of watched lobbies, so that a
+// LobbyDataUpdate_t can be turned into the list of keys which actually
+// changed. Steam can't enumerate lobby member data, so member data is only
+// mirrored for the member keys given when the lobby is watched.
+class LobbyDataMirror {
+ public:
+  static LobbyDataMirror* GetInstance();
+
+  void Watch(CSteamID lobby_id, const std::vector<std::string>& member_keys);
+  bool Unwatch(CSteamID lobby_id);
+
+  // Refreshes the mirror after a LobbyDataUpdate_t. |member_id| is the lobby
+  // itself when the lobby data changed. Members who left the lobby since are
+  // dropped as by RemoveDepartedMembers. Returns false if |lobby_id| isn't
+  // watched.
+  bool Update(CSteamID lobby_id, CSteamID member_id, LobbyDataDiff* diff,
+              std::map<uint64, LobbyDataDiff>* departed);
+
+  // Drops the mirrored data of members who are no longer in |lobby_id|,
+  // reporting all of their keys as removed in |departed|, by member.
+  void RemoveDepartedMembers(CSteamID lobby_id,
+                             std::map<uint64, LobbyDataDiff>* departed);
+
+ private:
+  typedef std::map<std::string, std::string> KeyValues;
+
+  struct Lobby {
+    std::vector<std::string> member_keys;
+    KeyValues data;
+    std::map<uint64, KeyValues> member_data;
+  };
+
+  LobbyDataMirror() {}
+
+  static KeyValues ReadLobbyData(CSteamID lobby_id);
+  static KeyValues ReadMemberData(CSteamID lobby_id, CSteamID member_id,
+                                  const std::vector<std::string>& keys);
+  static void Diff(const KeyValues& old_values, const KeyValues& new_values,
+                   LobbyDataDiff* diff);
+  static void RemoveDepartedMembers(CSteamID lobby_id, Lobby* lobby,
+                                    std::map<uint64, LobbyDataDiff>* departed);
+
+  std::map<uint64, Lobby> lobbies_;
+};
+
+}  // namespace greenworks
+
+#endif  // SRC_STEAM_LOBBY_DATA_MIRROR_H_
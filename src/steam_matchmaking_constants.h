@@ -0,0 +1,15 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+#ifndef SRC_STEAM_MATCHMAKING_CONSTANTS_H_
+#define SRC_STEAM_MATCHMAKING_CONSTANTS_H_
+
+namespace greenworks {
+
+// Lobby chat messages are limited to 4 KB by Steam.
+const int kMaxLobbyChatMsgSize = 4096;
+
+}  // namespace greenworks
+
+#endif  // SRC_STEAM_MATCHMAKING_CONSTANTS_H_
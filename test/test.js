@@ -20,6 +20,104 @@ describe('greenworks API', function () {
     });
   });
 
+  describe('saveTextToFile with compression', function () {
+    it('Should read back the original content.', function (done) {
+      var content = JSON.stringify({ level: 1, items: new Array(100).fill('sword') });
+      greenworks.saveTextToFile('test_compressed.json', content,
+        { compress: true }, function () {
+          greenworks.readTextFromFile('test_compressed.json', function (message) {
+            assert.equal(message, content); done();
+          }, function (err) { throw err; });
+        }, function (err) { throw err; });
+    });
+
+    // Saves |content| to Steam Cloud as is, bypassing compression.
+    function saveRaw(file_name, content, callback) {
+      var stream = greenworks.createCloudFileWriteStream(file_name);
+      stream.on('error', function (err) { throw err; });
+      stream.end(content, callback);
+    }
+
+    function assertReadFails(file_name, done) {
+      greenworks.readFileFromCloud(file_name, function () {
+        throw 'Error';
+      }, function (err) { done(); });
+    }
+
+    var header = Buffer.from([0, 0x47, 0x57, 0x5a, 1, 8, 0, 0]);
+
+    it('Should fail on a truncated header.', function (done) {
+      saveRaw('test_truncated.bin', header.slice(0, 6), function () {
+        assertReadFails('test_truncated.bin', done);
+      });
+    });
+
+    it('Should fail on an impossible original size.', function (done) {
+      var size = Buffer.alloc(8, 0xff);
+      saveRaw('test_huge.bin', Buffer.concat([header, size, Buffer.alloc(16)]),
+        function () { assertReadFails('test_huge.bin', done); });
+    });
+
+    it('Should fail on corrupt compressed content.', function (done) {
+      var size = Buffer.from([100, 0, 0, 0, 0, 0, 0, 0]);
+      saveRaw('test_corrupt.bin',
+        Buffer.concat([header, size, Buffer.alloc(16, 0x55)]), function () {
+          assertReadFails('test_corrupt.bin', done);
+        });
+    });
+
+    it('Should return uncompressed files as they are.', function (done) {
+      var content = Buffer.from([1, 0x47, 0x57, 0x5a, 1, 8, 0, 0]);
+      saveRaw('test_plain.bin', content, function () {
+        greenworks.readFileFromCloud('test_plain.bin', function (buffer) {
+          assert(buffer.equals(content)); done();
+        }, function (err) { throw err; });
+      });
+    });
+  });
+
+  describe('syncFilesToCloud', function () {
+    var file = require('path').join(require('os').tmpdir(), 'test_sync.txt');
+    var manifest = file + '.manifest';
+
+    it('Should only upload changed files.', function (done) {
+      require('fs').writeFileSync(file, 'test_sync');
+      greenworks.syncFilesToCloud([file], manifest, function () {
+        greenworks.syncFilesToCloud([file], manifest, function (uploaded) {
+          assert.equal(uploaded.length, 0); done();
+        }, function (err) { throw err; });
+      }, function (err) { throw err; });
+    });
+  });
+
+  describe('saveDeltaFileToCloud', function () {
+    var file = require('path').join(require('os').tmpdir(), 'test_delta.bin');
+    var content = Buffer.alloc(64 * 1024, 'world');
+
+    it('Should upload a delta after the checkpoint.', function (done) {
+      require('fs').writeFileSync(file, content);
+      greenworks.saveDeltaFileToCloud(file, function () {
+        content.write('changed', 1000);
+        require('fs').writeFileSync(file, content);
+        greenworks.saveDeltaFileToCloud(file, function (result) {
+          assert(!result.checkpoint);
+          greenworks.readDeltaFileFromCloud('test_delta.bin', function (buffer) {
+            assert(buffer.equals(content)); done();
+          }, function (err) { throw err; });
+        }, function (err) { throw err; });
+      }, function (err) { throw err; });
+    });
+  });
+
+  describe('createCloudFileWriteStream', function () {
+    it('Should save successfully.', function (done) {
+      var stream = greenworks.createCloudFileWriteStream('test_stream.bin');
+      stream.on('error', function (err) { throw err; });
+      stream.write(Buffer.from('test_'));
+      stream.end(Buffer.from('stream'), function () { done(); });
+    });
+  });
+
   describe('readTextFromFile', function () {
     it('Should read successfully.', function (done) {
       greenworks.readTextFromFile('test_file.txt', function (message) {
@@ -29,6 +127,23 @@ describe('greenworks API', function () {
       });
     });
 
+    it('Should read a range as a Buffer.', function (done) {
+      greenworks.readFileFromCloud('test_file.txt', { offset: 5, length: 4 },
+        function (buffer) {
+          assert(Buffer.isBuffer(buffer));
+          assert.equal(buffer.toString(), 'cont'); done();
+        }, function (err) { throw err; });
+    });
+
+    it('Should read multiple files.', function (done) {
+      greenworks.readFiles(['test_file.txt', 'test_stream.bin'])
+        .then(function (files) {
+          assert.equal(files['test_file.txt'].toString(), 'test_content');
+          assert.equal(files['test_stream.bin'].toString(), 'test_stream');
+          done();
+        }).catch(done);
+    });
+
     it('Should read failed.', function (done) {
       greenworks.readTextFromFile('not_exist.txt', function (message) {
         throw 'Error';
@@ -36,6 +151,122 @@ describe('greenworks API', function () {
     })
   });
 
+  describe('listCloudFiles', function () {
+    it('Should list matching files', function () {
+      var files = greenworks.listCloudFiles('test_*.txt');
+      assert(files.names.indexOf('test_file.txt') >= 0);
+      assert.equal(files.names.length, files.sizes.length);
+    });
+  });
+
+  describe('createArchive&extractArchive', function () {
+    var fs = require('fs');
+    var path = require('path');
+    var dir = fs.mkdtempSync(path.join(require('os').tmpdir(), 'greenworks-'));
+    var source = path.join(dir, 'source');
+
+    it('Should round trip a directory', function (done) {
+      fs.mkdirSync(path.join(source, 'sub'), { recursive: true });
+      for (var i = 0; i < 20; ++i)
+        fs.writeFileSync(path.join(source, 'sub', 'file' + i), 'content' + i);
+      greenworks.Utils.createArchive(path.join(dir, 'test.zip'), source, '', 6,
+          { threads: 4 }, function () {
+        greenworks.Utils.extractArchive(path.join(dir, 'test.zip'),
+            path.join(dir, 'out'), '', { threads: 4 }, function () {
+          assert.equal(fs.readFileSync(
+              path.join(dir, 'out', 'source', 'sub', 'file7'), 'utf8'),
+              'content7');
+          done();
+        }, function (err) { throw err; });
+      }, function (err) { throw err; });
+    });
+
+    it('Should update an archive', function (done) {
+      fs.writeFileSync(path.join(source, 'sub', 'file7'), 'updated');
+      greenworks.Utils.createArchive(path.join(dir, 'test.zip'), source, '', 6,
+          { update: true }, function () {
+        greenworks.Utils.extractArchive(path.join(dir, 'test.zip'),
+            path.join(dir, 'updated'), '', function () {
+          assert.equal(fs.readFileSync(
+              path.join(dir, 'updated', 'source', 'sub', 'file7'), 'utf8'),
+              'updated');
+          assert.equal(fs.readFileSync(
+              path.join(dir, 'updated', 'source', 'sub', 'file8'), 'utf8'),
+              'content8');
+          done();
+        }, function (err) { throw err; });
+      }, function (err) { throw err; });
+    });
+
+    it('Should report progress and cancel', function (done) {
+      var last = null;
+      greenworks.Utils.extractArchive(path.join(dir, 'test.zip'),
+          path.join(dir, 'progress'), '', {
+            progress: function (progress) { last = progress; }
+          }, function () {
+        assert.equal(last.entries, last.totalEntries);
+        assert.equal(last.bytes, last.totalBytes);
+        var handle = greenworks.Utils.createArchive(
+            path.join(dir, 'cancelled.zip'), source, '', 6, function () {
+          throw new Error('Should be cancelled');
+        }, function (err) {
+          assert(!fs.existsSync(path.join(dir, 'cancelled.zip')));
+          assert.equal(greenworks.Utils.cancelArchive(handle), false);
+          done();
+        });
+        assert.equal(greenworks.Utils.cancelArchive(handle), true);
+      }, function (err) { throw err; });
+    });
+
+    it('Should list and read single entries', function (done) {
+      var zip = path.join(dir, 'test.zip');
+      greenworks.Utils.listArchive(zip, function (listing) {
+        var index = listing.names.indexOf('source/sub/file8');
+        assert(index >= 0);
+        assert.equal(listing.sizes[index], 'content8'.length);
+        assert.equal(listing.names.length, listing.crcs.length);
+        greenworks.Utils.readEntry(zip, 'source/sub/file8', function (buffer) {
+          assert.equal(buffer.toString(), 'content8');
+          greenworks.Utils.extractEntries(zip, 'source/**/file1?',
+              path.join(dir, 'some'), function () {
+            assert(fs.existsSync(path.join(dir, 'some', 'source', 'sub', 'file12')));
+            assert(!fs.existsSync(path.join(dir, 'some', 'source', 'sub', 'file8')));
+            done();
+          }, function (err) { throw err; });
+        }, function (err) { throw err; });
+      }, function (err) { throw err; });
+    });
+  });
+
+  describe('createArchiveToBuffer&extractArchiveFromBuffer', function () {
+    it('Should round trip entries in memory', function (done) {
+      greenworks.Utils.createArchiveToBuffer(
+          { 'a.txt': 'hello', 'dir/b.bin': Buffer.alloc(100000, 7) },
+          { level: 9 }, function (archive) {
+        greenworks.Utils.extractArchiveFromBuffer(archive, function (entries) {
+          assert.equal(entries['a.txt'].toString(), 'hello');
+          assert(entries['dir/b.bin'].equals(Buffer.alloc(100000, 7)));
+          done();
+        }, function (err) { throw err; });
+      }, function (err) { throw err; });
+    });
+
+    it('Should store incompressible entries', function (done) {
+      var noise = require('crypto').randomBytes(100000);
+      greenworks.Utils.createArchiveToBuffer(
+          { 'noise.bin': noise, 'a.json': '{"a": 1}' },
+          { adaptiveLevels: true }, function (archive) {
+        // The random data is stored, so the archive can't be smaller.
+        assert(archive.length > noise.length);
+        greenworks.Utils.extractArchiveFromBuffer(archive, function (entries) {
+          assert(entries['noise.bin'].equals(noise));
+          assert.equal(entries['a.json'].toString(), '{"a": 1}');
+          done();
+        }, function (err) { throw err; });
+      }, function (err) { throw err; });
+    });
+  });
+
   describe('enableCloud&isCloudEnabled', function () {
     it('', function () {
       greenworks.enableCloud(false);
@@ -167,6 +398,8 @@ describe('greenworks API', function () {
       assert(typeof greenworks.getConnectionInfo === 'function');
       assert(typeof greenworks.getQuickConnectionStatus === 'function');
       assert(typeof greenworks.runNetworkingCallbacks === 'function');
+      assert(typeof greenworks.createNetworkingConfigProfile === 'function');
+      assert(typeof greenworks.deleteNetworkingConfigProfile === 'function');
     });
 
     it('Should have networking messages functions', function () {
@@ -185,6 +418,8 @@ describe('greenworks API', function () {
       assert(typeof greenworks.checkPingDataUpToDate === 'function');
       assert(typeof greenworks.getPOPCount === 'function');
       assert(typeof greenworks.getPOPList === 'function');
+      assert(typeof greenworks.getLocalPingLocation === 'function');
+      assert(typeof greenworks.estimatePingTimeBetweenTwoLocations === 'function');
     });
 
     it('Should have networking constants', function () {
@@ -203,6 +438,28 @@ describe('greenworks API', function () {
     });
   });
 
+  describe('Lobby snapshot APIs', function () {
+    it('Should have lobby snapshot functions', function () {
+      assert(typeof greenworks.getLobbyListSnapshot === 'function');
+      assert(typeof greenworks.watchLobbyData === 'function');
+      assert(typeof greenworks.unwatchLobbyData === 'function');
+      assert(typeof greenworks.searchLobbies === 'function');
+      assert(typeof greenworks.getLobbyMembersSnapshot === 'function');
+    });
+
+    it('Should return an empty snapshot without a lobby list', function () {
+      assert(Array.isArray(greenworks.getLobbyListSnapshot()));
+    });
+
+    it('Should accept ping options', function () {
+      assert(Array.isArray(greenworks.getLobbyListSnapshot(undefined,
+          { pingKey: 'ping_location', sortByPing: true })));
+      assert.throws(function () {
+        greenworks.getLobbyListSnapshot(undefined, { pingKey: 1 });
+      });
+    });
+  });
+
   describe('getFriends', function () {
     it('Should get successfully', function (done) {
       assert(greenworks.FriendFlags);
@@ -0,0 +1,463 @@
+// Copyright (c) 2016 Greenheart Games Pty. Ltd. All rights reserved.
+// Use of this source code is governed by the MIT license that can be
+// found in the LICENSE file.
+
+// Measures the throughput of greenworks::zip and greenworks::unzip on
+// synthetic trees, across compression levels, memory budgets and thread
+// counts, and prints the results as JSON. See docs/archive-benchmark.md.
+
+#include <ftw.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "greenworks_unzip.h"
+#include "greenworks_zip.h"
+
+namespace {
+
+struct BenchmarkOptions {
+  std::string work_dir;
+  std::string out_path;
+  double scale = 1;
+  int repeat = 3;
+  std::vector<int> levels = {1, 6, 9};
+  std::vector<int> threads = {1, 0};
+  // In MB, 0 for the default.
+  std::vector<int> buffers = {0, 4};
+  bool keep = false;
+};
+
+struct Tree {
+  const char* name = nullptr;
+  std::string path;
+  uint64_t files = 0;
+  uint64_t bytes = 0;
+};
+
+struct Timing {
+  std::vector<double> runs;
+  double median = 0;
+};
+
+// splitmix64, so the trees are the same on every run and machine.
+class Random {
+ public:
+  explicit Random(uint64_t seed) : state_(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // In [min, max].
+  uint64_t Range(uint64_t min, uint64_t max) {
+    return min + Next() % (max - min + 1);
+  }
+
+ private:
+  uint64_t state_;
+};
+
+const char* const kWords[] = {
+  "player", "level", "score", "health", "inventory", "sword", "shield",
+  "quest", "enemy", "texture", "shader", "mesh", "sound", "volume", "true",
+  "false", "null", "position", "rotation", "scale", "name", "id", "value",
+  "items", "spawn", "damage", "speed", "config", "locale", "dialog",
+};
+
+// JSON-like lines, which deflate about as well as game data and scripts.
+void AppendText(Random* random, size_t size, std::string* content) {
+  size_t end = content->size() + size;
+  while (content->size() < end) {
+    *content += "  \"";
+    *content += kWords[random->Next() % (sizeof(kWords) / sizeof(kWords[0]))];
+    *content += "_";
+    *content += kWords[random->Next() % (sizeof(kWords) / sizeof(kWords[0]))];
+    *content += "\": ";
+    *content += std::to_string(random->Range(0, 100000));
+    *content += ",\n";
+  }
+  content->resize(end);
+}
+
+// Like already compressed media: deflate can't gain anything.
+void AppendRandom(Random* random, size_t size, std::string* content) {
+  size_t end = content->size() + size;
+  while (content->size() < end) {
+    uint64_t value = random->Next();
+    content->append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+  content->resize(end);
+}
+
+// Alternates 64KB of text and of random data, like packed game assets.
+void AppendSemi(Random* random, size_t size, std::string* content) {
+  const size_t kChunk = 64 * 1024;
+  for (size_t pos = 0; pos < size; pos += kChunk) {
+    size_t chunk = std::min(kChunk, size - pos);
+    if ((pos / kChunk) % 2)
+      AppendRandom(random, chunk, content);
+    else
+      AppendText(random, chunk, content);
+  }
+}
+
+bool MakeDirs(const std::string& path) {
+  for (size_t separator = path.find('/', 1);;
+       separator = path.find('/', separator + 1)) {
+    std::string dir = path.substr(0, separator);
+    if (mkdir(dir.c_str(), 0775) != 0 && errno != EEXIST)
+      return false;
+    if (separator == std::string::npos)
+      return true;
+  }
+}
+
+bool WriteFile(Tree* tree, const std::string& name,
+               const std::string& content) {
+  std::string path = tree->path + "/" + name;
+  if (!MakeDirs(path.substr(0, path.rfind('/'))))
+    return false;
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr)
+    return false;
+  bool written = fwrite(content.data(), 1, content.size(), file) ==
+                 content.size();
+  written = fclose(file) == 0 && written;
+  tree->files += 1;
+  tree->bytes += content.size();
+  return written;
+}
+
+// Many small text files, as in a mod or a save folder.
+bool MakeSmallFiles(Random* random, double scale, Tree* tree) {
+  const char* const kExtensions[] = {"json", "lua", "txt", "xml"};
+  uint64_t count = static_cast<uint64_t>(10000 * scale);
+  std::string content;
+  for (uint64_t i = 0; i < count; ++i) {
+    content.clear();
+    AppendText(random, random->Range(256, 8192), &content);
+    std::string name = "d" + std::to_string(i % 100) + "/f" +
+                       std::to_string(i) + "." + kExtensions[i % 4];
+    if (!WriteFile(tree, name, content))
+      return false;
+  }
+  return true;
+}
+
+// A few large files, half text and half packed assets.
+bool MakeLargeFiles(Random* random, double scale, Tree* tree) {
+  size_t size = static_cast<size_t>(32 * 1024 * 1024 * scale);
+  std::string content;
+  for (int i = 0; i < 4; ++i) {
+    content.clear();
+    if (i % 2)
+      AppendSemi(random, size, &content);
+    else
+      AppendText(random, size, &content);
+    std::string name =
+        "large" + std::to_string(i) + (i % 2 ? ".pak" : ".txt");
+    if (!WriteFile(tree, name, content))
+      return false;
+  }
+  return true;
+}
+
+// Files from 1KB to 4MB of mixed compressibility, as in a game install.
+bool MakeMixedFiles(Random* random, double scale, Tree* tree) {
+  uint64_t count = static_cast<uint64_t>(200 * scale);
+  std::string content;
+  for (uint64_t i = 0; i < count; ++i) {
+    // Log-uniform sizes, so most files are small but most bytes are in large
+    // ones.
+    size_t size = static_cast<size_t>(1024) << random->Range(0, 11);
+    size += random->Range(0, size - 1);
+    content.clear();
+    const char* extension;
+    switch (random->Range(0, 4)) {
+      case 0:
+      case 1:
+        AppendRandom(random, size, &content);
+        extension = i % 2 ? "png" : "ogg";
+        break;
+      case 2:
+      case 3:
+        AppendText(random, size, &content);
+        extension = "json";
+        break;
+      default:
+        AppendSemi(random, size, &content);
+        extension = "bin";
+        break;
+    }
+    std::string name = "assets/" + std::to_string(i % 16) + "/a" +
+                       std::to_string(i) + "." + extension;
+    if (!WriteFile(tree, name, content))
+      return false;
+  }
+  return true;
+}
+
+int RemoveEntry(const char* path, const struct stat*, int, struct FTW*) {
+  return remove(path);
+}
+
+void RemoveTree(const std::string& path) {
+  nftw(path.c_str(), RemoveEntry, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+uint64_t tree_bytes = 0;
+
+int AddEntryBytes(const char*, const struct stat* s, int type, struct FTW*) {
+  if (type == FTW_F)
+    tree_bytes += s->st_size;
+  return 0;
+}
+
+uint64_t TreeBytes(const std::string& path) {
+  tree_bytes = 0;
+  nftw(path.c_str(), AddEntryBytes, 64, FTW_PHYS);
+  return tree_bytes;
+}
+
+uint64_t FileBytes(const std::string& path) {
+  struct stat s;
+  return stat(path.c_str(), &s) == 0 ? s.st_size : 0;
+}
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+void SetMedian(Timing* timing) {
+  std::vector<double> runs = timing->runs;
+  std::sort(runs.begin(), runs.end());
+  size_t middle = runs.size() / 2;
+  timing->median = runs.size() % 2 ? runs[middle]
+                                   : (runs[middle - 1] + runs[middle]) / 2;
+}
+
+void PrintTiming(FILE* out, const char* name, const Timing& timing,
+                 uint64_t bytes) {
+  fprintf(out, "\"%s\": {\"seconds\": %.4f, \"mb_per_s\": %.2f, \"runs\": [",
+          name, timing.median, bytes / 1e6 / timing.median);
+  for (size_t i = 0; i < timing.runs.size(); ++i)
+    fprintf(out, "%s%.4f", i ? ", " : "", timing.runs[i]);
+  fprintf(out, "]}");
+}
+
+bool ParseList(const char* value, std::vector<int>* list) {
+  list->clear();
+  for (const char* pos = value; *pos;) {
+    char* end;
+    long number = strtol(pos, &end, 10);
+    if (end == pos || number < 0 || (*end && *end != ','))
+      return false;
+    list->push_back(static_cast<int>(number));
+    pos = *end ? end + 1 : end;
+  }
+  return !list->empty();
+}
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    size_t equals = arg.find('=');
+    std::string name = arg.substr(0, equals);
+    const char* value =
+        equals == std::string::npos ? "" : argv[i] + equals + 1;
+    if (name == "--dir") {
+      options->work_dir = value;
+    } else if (name == "--out") {
+      options->out_path = value;
+    } else if (name == "--scale") {
+      options->scale = atof(value);
+      if (options->scale <= 0)
+        return false;
+    } else if (name == "--repeat") {
+      options->repeat = atoi(value);
+      if (options->repeat <= 0)
+        return false;
+    } else if (name == "--levels") {
+      if (!ParseList(value, &options->levels))
+        return false;
+      for (int level : options->levels)
+        if (level > 9)
+          return false;
+    } else if (name == "--threads") {
+      if (!ParseList(value, &options->threads))
+        return false;
+    } else if (name == "--buffers") {
+      if (!ParseList(value, &options->buffers))
+        return false;
+    } else if (name == "--keep") {
+      options->keep = true;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Zips and unzips |tree| |options.repeat| times with the given settings, and
+// prints the median times. Returns false if an archive doesn't round trip.
+bool RunCase(const BenchmarkOptions& options, const Tree& tree, int level,
+             int threads, int buffer, FILE* out, bool first) {
+  fprintf(stderr, "%s level=%d threads=%d buffer=%dMB\n", tree.name, level,
+          threads, buffer);
+  std::string archive = options.work_dir + "/benchmark.zip";
+  std::string extract_dir = options.work_dir + "/extracted";
+  greenworks::ZipOptions zip_options;
+  zip_options.compression_level = level;
+  zip_options.num_threads = threads;
+  zip_options.max_bytes_in_flight = static_cast<size_t>(buffer) * 1024 * 1024;
+  greenworks::UnzipOptions unzip_options;
+  unzip_options.num_threads = threads;
+
+  Timing zip_timing;
+  Timing unzip_timing;
+  uint64_t archive_bytes = 0;
+  for (int run = 0; run < options.repeat; ++run) {
+    remove(archive.c_str());
+    auto start = std::chrono::steady_clock::now();
+    int err = greenworks::zip(archive.c_str(), tree.path.c_str(), zip_options);
+    zip_timing.runs.push_back(Seconds(start));
+    archive_bytes = FileBytes(archive);
+
+    RemoveTree(extract_dir);
+    start = std::chrono::steady_clock::now();
+    if (err == 0) {
+      err = greenworks::unzip(archive.c_str(), extract_dir.c_str(),
+                              unzip_options);
+    }
+    unzip_timing.runs.push_back(Seconds(start));
+    if (err != 0 || TreeBytes(extract_dir) != tree.bytes) {
+      fprintf(stderr, "Error on archiving %s: %d\n", tree.name, err);
+      return false;
+    }
+  }
+  SetMedian(&zip_timing);
+  SetMedian(&unzip_timing);
+
+  fprintf(out, "%s\n    {\"tree\": \"%s\", \"level\": %d, \"threads\": %d, "
+          "\"max_bytes_in_flight\": %llu, \"archive_bytes\": %llu, "
+          "\"ratio\": %.4f, ",
+          first ? "" : ",", tree.name, level, threads,
+          static_cast<unsigned long long>(zip_options.max_bytes_in_flight),
+          static_cast<unsigned long long>(archive_bytes),
+          static_cast<double>(archive_bytes) / tree.bytes);
+  PrintTiming(out, "zip", zip_timing, tree.bytes);
+  fprintf(out, ", ");
+  PrintTiming(out, "unzip", unzip_timing, tree.bytes);
+  fprintf(out, "}");
+  return true;
+}
+
+const char kUsage[] =
+    "Usage: archive_benchmark [options]\n"
+    "  --dir=PATH       Where the trees and archives are written, a new\n"
+    "                   temporary directory by default.\n"
+    "  --out=PATH       Writes the JSON results to PATH instead of stdout.\n"
+    "  --scale=N        Multiplies the size of the trees, 1 by default.\n"
+    "  --repeat=N       Runs of each case, the median is reported. 3 by\n"
+    "                   default.\n"
+    "  --levels=L,...   Compression levels, 1,6,9 by default.\n"
+    "  --threads=N,...  Thread counts, 0 for one per core. 1,0 by default.\n"
+    "  --buffers=MB,... Memory budgets of zip, 0 for the default. 0,4 by\n"
+    "                   default.\n"
+    "  --keep           Keeps the trees and archives.\n";
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  BenchmarkOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    fputs(kUsage, stderr);
+    return 2;
+  }
+  if (options.work_dir.empty()) {
+    char temp_dir[] = "/tmp/archive_benchmark.XXXXXX";
+    if (mkdtemp(temp_dir) == nullptr) {
+      perror("mkdtemp");
+      return 1;
+    }
+    options.work_dir = temp_dir;
+  }
+
+  const char* const kTreeNames[] = {"small_files", "large_files", "mixed"};
+  bool (*makers[])(Random*, double, Tree*) = {
+      MakeSmallFiles, MakeLargeFiles, MakeMixedFiles};
+  Tree trees[3];
+  for (size_t i = 0; i < 3; ++i) {
+    trees[i].name = kTreeNames[i];
+    trees[i].path = options.work_dir + "/" + trees[i].name;
+    Random random(i + 1);
+    fprintf(stderr, "Generating %s...\n", trees[i].name);
+    RemoveTree(trees[i].path);
+    if (!makers[i](&random, options.scale, &trees[i])) {
+      fprintf(stderr, "Error on writing %s.\n", trees[i].path.c_str());
+      return 1;
+    }
+  }
+
+  FILE* out = stdout;
+  if (!options.out_path.empty()) {
+    out = fopen(options.out_path.c_str(), "w");
+    if (out == nullptr) {
+      perror(options.out_path.c_str());
+      return 1;
+    }
+  }
+  fprintf(out, "{\n  \"hardware_concurrency\": %u,\n",
+          std::thread::hardware_concurrency());
+  fprintf(out, "  \"scale\": %g,\n  \"repeat\": %d,\n", options.scale,
+          options.repeat);
+  fprintf(out, "  \"trees\": [\n");
+  for (size_t i = 0; i < 3; ++i) {
+    fprintf(out, "    {\"name\": \"%s\", \"files\": %llu, \"bytes\": %llu}%s\n",
+            trees[i].name, static_cast<unsigned long long>(trees[i].files),
+            static_cast<unsigned long long>(trees[i].bytes), i < 2 ? "," : "");
+  }
+  fprintf(out, "  ],\n  \"results\": [");
+
+  int status = 0;
+  bool first = true;
+  for (const Tree& tree : trees) {
+    for (int level : options.levels) {
+      for (int threads : options.threads) {
+        for (int buffer : options.buffers) {
+          if (status == 0 &&
+              !RunCase(options, tree, level, threads, buffer, out, first))
+            status = 1;
+          first = false;
+        }
+      }
+    }
+  }
+  fprintf(out, "\n  ]\n}\n");
+  if (out != stdout)
+    fclose(out);
+
+  remove((options.work_dir + "/benchmark.zip").c_str());
+  RemoveTree(options.work_dir + "/extracted");
+  if (!options.keep) {
+    for (Tree& tree : trees)
+      RemoveTree(tree.path);
+    rmdir(options.work_dir.c_str());
+  }
+  return status;
+}